@@ -7,8 +7,10 @@
  *  (Page 29-33)
  **/
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <map>
+#include <string_view>
 
 #include "../utils/Object.hpp"
 
@@ -42,31 +44,21 @@ class Netconnection
             FCPublish
         }; 
         
-        static inline map<std::string, CommandType> CommandLinker = {
-            {"connect", CommandType::Connect},
-            {"connectResponse", CommandType::ConnectResponse},
-            {"call", CommandType::Call},
-            {"callResponse", CommandType::CallResponse},
-            {"createStream", CommandType::CreateStream},
-            {"createStreamResponse", CommandType::CreateStreamResponse},
-            {"onStatus", CommandType::OnStatus},
-            {"play", CommandType::Play},
-            {"play2", CommandType::Play2},
-            {"deleteStream", CommandType::DeleteStream},
-            {"receiveAudio", CommandType::ReceiveAudio},
-            {"receiveVideo", CommandType::ReceiveVideo},
-            {"publish", CommandType::Publish},
-            {"seek", CommandType::Seek},
-            {"pause", CommandType::Pause},
-            {"releaseStream", CommandType::ReleaseStream},
-            {"FCPublish", CommandType::FCPublish}
-        };
+        /**
+         * Command type of a command name, Null if unknown.
+         * One hash and one comparison: the hash is perfect over the
+         * names below, its seed searched at compile time.
+         **/
+        static constexpr CommandType FindCommandType(std::string_view name);
 
 
         struct Command
         {
             /**
              * Command Type
+             *
+             * Set by the constructor of each command, read through
+             * Command to dispatch it.
              **/
             CommandType type = CommandType::Null;
             /**
@@ -96,7 +88,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Connect;
+            Connect() { type = CommandType::Connect; }
 
             /**
              * Command Name
@@ -121,7 +113,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::ConnectResponse;
+            ConnectResponse() { type = CommandType::ConnectResponse; }
 
             /**
              * Command Name
@@ -159,7 +151,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Call;
+            Call() { type = CommandType::Call; }
             
             /**
              * Procedure Name
@@ -187,7 +179,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::CallResponse;
+            CallResponse() { type = CommandType::CallResponse; }
             
             /**
              * Transaction ID
@@ -217,7 +209,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::CreateStream;
+            CreateStream() { type = CommandType::CreateStream; }
 
             /**
              * Command Name
@@ -237,7 +229,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::CreateStreamResponse;
+            CreateStreamResponse() { type = CommandType::CreateStreamResponse; }
 
             /**
              * Command Name
@@ -259,7 +251,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::OnStatus;
+            OnStatus() { type = CommandType::OnStatus; }
             
             /**
              * Command Name
@@ -289,7 +281,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Play;
+            Play() { type = CommandType::Play; }
 
             /**
              * Command Name
@@ -352,7 +344,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Play2;
+            Play2() { type = CommandType::Play2; }
 
             /**
              * Command Name
@@ -385,7 +377,7 @@ class Netconnection
             /**
              * Command type.
              **/
-            CommandType type = CommandType::DeleteStream;
+            DeleteStream() { type = CommandType::DeleteStream; }
 
             /**
              * Command Name
@@ -408,7 +400,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::ReceiveAudio;
+            ReceiveAudio() { type = CommandType::ReceiveAudio; }
 
             /**
              * Command Name
@@ -440,7 +432,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::ReceiveVideo;
+            ReceiveVideo() { type = CommandType::ReceiveVideo; }
 
             /**
              * Command Name
@@ -472,7 +464,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Publish;
+            Publish() { type = CommandType::Publish; }
             
             /**
              * Command Name
@@ -520,7 +512,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Seek;
+            Seek() { type = CommandType::Seek; }
 
             /**
              * Command Name
@@ -554,7 +546,7 @@ class Netconnection
             /**
              * Command Type
              **/
-            CommandType type = CommandType::Pause;
+            Pause() { type = CommandType::Pause; }
 
             /**
              * Command Name
@@ -595,7 +587,7 @@ class Netconnection
 
         struct ReleaseStream : public Command
         {
-            CommandType type = CommandType::ReleaseStream;
+            ReleaseStream() { type = CommandType::ReleaseStream; }
 
             std::string CommandName = "releaseStream";
 
@@ -606,7 +598,7 @@ class Netconnection
 
         struct FCPublish : public Command
         {
-            CommandType type = CommandType::FCPublish;
+            FCPublish() { type = CommandType::FCPublish; }
             std::string CommandName = "FCPublish";
 
             unsigned short TransactionID = 0;
@@ -767,4 +759,106 @@ class Netconnection
             AMF0 = 0,
             AMF3 = 3
         };
-};
\ No newline at end of file
+};
+
+/**
+ * Command names, hashed at compile time.
+ **/
+namespace NetconnectionCommands
+{
+    struct Entry
+    {
+        std::string_view name;
+        Netconnection::CommandType type = Netconnection::CommandType::Null;
+    };
+
+    inline constexpr Entry Names[] = {
+        {"connect", Netconnection::CommandType::Connect},
+        {"connectResponse", Netconnection::CommandType::ConnectResponse},
+        {"call", Netconnection::CommandType::Call},
+        {"callResponse", Netconnection::CommandType::CallResponse},
+        {"createStream", Netconnection::CommandType::CreateStream},
+        {"createStreamResponse", Netconnection::CommandType::CreateStreamResponse},
+        {"onStatus", Netconnection::CommandType::OnStatus},
+        {"play", Netconnection::CommandType::Play},
+        {"play2", Netconnection::CommandType::Play2},
+        {"deleteStream", Netconnection::CommandType::DeleteStream},
+        {"receiveAudio", Netconnection::CommandType::ReceiveAudio},
+        {"receiveVideo", Netconnection::CommandType::ReceiveVideo},
+        {"publish", Netconnection::CommandType::Publish},
+        {"seek", Netconnection::CommandType::Seek},
+        {"pause", Netconnection::CommandType::Pause},
+        {"releaseStream", Netconnection::CommandType::ReleaseStream},
+        {"FCPublish", Netconnection::CommandType::FCPublish}
+    };
+
+    inline constexpr size_t TableSize = 32;
+    inline constexpr uint32_t MaximumSeed = 1 << 16;
+
+    /**
+     * The length, first and last two characters tell every name apart
+     * (receiveAudio and receiveVideo differ at the one before last).
+     * Names are at least 2 characters long.
+     **/
+    constexpr size_t Hash(std::string_view name, uint32_t seed)
+    {
+        uint32_t hash = (seed ^ (uint32_t)name.size()) * 0x01000193;
+        hash = (hash ^ (unsigned char)name[0]) * 0x01000193;
+        hash = (hash ^ (unsigned char)name[name.size() - 2]) * 0x01000193;
+        hash = (hash ^ (unsigned char)name[name.size() - 1]) * 0x01000193;
+        return (hash >> 16) % TableSize;
+    }
+
+    constexpr bool Collides(uint32_t seed)
+    {
+        bool used[TableSize] = {};
+        for (const Entry& entry : Names)
+        {
+            size_t slot = Hash(entry.name, seed);
+            if (used[slot])
+                return true;
+            used[slot] = true;
+        }
+        return false;
+    }
+
+    constexpr uint32_t FindSeed()
+    {
+        uint32_t seed = 0;
+        while (seed < MaximumSeed && Collides(seed))
+            seed++;
+        return seed;
+    }
+
+    inline constexpr uint32_t Seed = FindSeed();
+    static_assert(Seed < MaximumSeed, "No perfect hash for the command names.");
+
+    struct Table
+    {
+        Entry slots[TableSize];
+    };
+
+    constexpr Table BuildTable()
+    {
+        Table table = {};
+        for (const Entry& entry : Names)
+            table.slots[Hash(entry.name, Seed)] = entry;
+        return table;
+    }
+
+    inline constexpr Table Slots = BuildTable();
+}
+
+constexpr Netconnection::CommandType Netconnection::FindCommandType(std::string_view name)
+{
+    if (name.size() < 2)
+        return CommandType::Null;
+
+    const NetconnectionCommands::Entry& entry = NetconnectionCommands::Slots.slots[NetconnectionCommands::Hash(name, NetconnectionCommands::Seed)];
+    return entry.name == name ? entry.type : CommandType::Null;
+}
+
+static_assert(Netconnection::FindCommandType("receiveVideo") == Netconnection::CommandType::ReceiveVideo
+    && Netconnection::FindCommandType("FCPublish") == Netconnection::CommandType::FCPublish
+    && Netconnection::FindCommandType("plays") == Netconnection::CommandType::Null,
+    "Command names must resolve.");
@@ -0,0 +1,462 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the zero-copy AMF0 decoder.
+ **/
+
+#include "RTMPAMF0.hpp"
+#include "RTMPAMF3.hpp"
+#include "RTMPEndian.hpp"
+
+#include <cstring>
+#include <new>
+
+namespace RTMP
+{
+    static constexpr size_t ArenaAlignment = alignof(max_align_t);
+
+    AMF0Arena::~AMF0Arena()
+    {
+        for (Block& block : blocks)
+            ::operator delete(block.data);
+    }
+
+    void* AMF0Arena::Allocate(size_t size)
+    {
+        size = (size + ArenaAlignment - 1) & ~(ArenaAlignment - 1);
+
+        // Next kept block large enough, or a new one.
+        while (current < blocks.size() && blocks[current].size - used < size)
+        {
+            current++;
+            used = 0;
+        }
+        if (current == blocks.size())
+        {
+            Block block;
+            block.size = size > BlockSize ? size : BlockSize;
+            block.data = static_cast<unsigned char*>(::operator new(block.size));
+            blocks.push_back(block);
+            used = 0;
+        }
+
+        void* memory = blocks[current].data + used;
+        used += size;
+        return memory;
+    }
+
+    void AMF0Arena::Reset()
+    {
+        size_t kept = 0;
+        for (Block& block : blocks)
+        {
+            if (block.size == BlockSize && kept < KeptBlocks)
+                blocks[kept++] = block;
+            else
+                ::operator delete(block.data);
+        }
+        blocks.resize(kept);
+
+        current = 0;
+        used = 0;
+    }
+
+    const AMF0Value* AMF0Value::Find(string_view key) const
+    {
+        for (size_t i = 0; i < count && properties != nullptr; i++)
+        {
+            if (properties[i].key == key)
+                return &properties[i].value;
+        }
+        return nullptr;
+    }
+
+    const AMF0Value& AMF0Command::Argument(size_t index) const
+    {
+        static const AMF0Value Undefined;
+        return index < argumentCount ? arguments[index] : Undefined;
+    }
+
+    /**
+     * Reads values from a message, bounds-checked.
+     **/
+    class AMF0Reader
+    {
+        private:
+            const unsigned char* position;
+            const unsigned char* end;
+            AMF0Arena& arena;
+            int depth = 0;
+
+            AMF3References references;
+
+            size_t Remaining() const { return (size_t)(end - position); }
+
+            bool ReadString(string_view& text, size_t lengthSize)
+            {
+                if (Remaining() < lengthSize)
+                    return false;
+                size_t length = lengthSize == 2 ? Endian::Load16BE(position) : Endian::Load32BE(position);
+                position += lengthSize;
+                if (Remaining() < length)
+                    return false;
+
+                text = string_view(reinterpret_cast<const char*>(position), length);
+                position += length;
+                return true;
+            }
+
+            bool ReadNumber(double& number)
+            {
+                if (Remaining() < 8)
+                    return false;
+                uint64_t bits = Endian::Load64BE(position);
+                memcpy(&number, &bits, sizeof(number));
+                position += 8;
+                return true;
+            }
+
+            /**
+             * Key/value pairs up to the object end marker, in a flat array
+             * grown by doubling in the arena.
+             **/
+            bool ReadProperties(AMF0Value& value)
+            {
+                AMF0Property* properties = nullptr;
+                size_t count = 0;
+                size_t capacity = 0;
+
+                for (;;)
+                {
+                    string_view key;
+                    if (!ReadString(key, 2))
+                        return false;
+
+                    // Empty key, then the object end marker.
+                    if (key.empty() && Remaining() > 0 && *position == 0x09)
+                    {
+                        position++;
+                        break;
+                    }
+
+                    if (count == capacity)
+                    {
+                        size_t grown = capacity ? capacity * 2 : 8;
+                        AMF0Property* larger = static_cast<AMF0Property*>(arena.Allocate(grown * sizeof(AMF0Property)));
+                        for (size_t i = 0; i < count; i++)
+                            new (&larger[i]) AMF0Property(properties[i]);
+                        properties = larger;
+                        capacity = grown;
+                    }
+
+                    AMF0Property* property = new (&properties[count]) AMF0Property();
+                    property->key = key;
+                    if (!Read(property->value))
+                        return false;
+                    count++;
+                }
+
+                value.properties = properties;
+                value.count = count;
+                return true;
+            }
+
+        public:
+            AMF0Reader(const unsigned char* data, size_t length, AMF0Arena& arena)
+                : position(data), end(data + length), arena(arena) {};
+
+            bool AtEnd() const { return position == end; }
+
+            bool Read(AMF0Value& value)
+            {
+                if (Remaining() < 1 || depth >= AMF0Decoder::MaximumDepth)
+                    return false;
+
+                unsigned char marker = *position++;
+                switch (marker)
+                {
+                    case 0x00:
+                        value.type = AMF0Value::Type::Number;
+                        return ReadNumber(value.number);
+
+                    case 0x01:
+                        if (Remaining() < 1)
+                            return false;
+                        value.type = AMF0Value::Type::Boolean;
+                        value.boolean = *position++ != 0;
+                        return true;
+
+                    case 0x02:
+                        value.type = AMF0Value::Type::String;
+                        return ReadString(value.string, 2);
+
+                    case 0x0C:
+                        value.type = AMF0Value::Type::String;
+                        return ReadString(value.string, 4);
+
+                    case 0x0F:
+                        value.type = AMF0Value::Type::XmlDocument;
+                        return ReadString(value.string, 4);
+
+                    case 0x03:
+                    {
+                        value.type = AMF0Value::Type::Object;
+                        depth++;
+                        bool read = ReadProperties(value);
+                        depth--;
+                        return read;
+                    }
+
+                    case 0x10:
+                    {
+                        value.type = AMF0Value::Type::TypedObject;
+                        if (!ReadString(value.string, 2))
+                            return false;
+                        depth++;
+                        bool read = ReadProperties(value);
+                        depth--;
+                        return read;
+                    }
+
+                    case 0x08:
+                    {
+                        // The count is only a hint; the end marker terminates.
+                        if (Remaining() < 4)
+                            return false;
+                        position += 4;
+                        value.type = AMF0Value::Type::EcmaArray;
+                        depth++;
+                        bool read = ReadProperties(value);
+                        depth--;
+                        return read;
+                    }
+
+                    case 0x0A:
+                    {
+                        if (Remaining() < 4)
+                            return false;
+                        size_t count = Endian::Load32BE(position);
+                        position += 4;
+
+                        // Every value takes a byte at least.
+                        if (count > Remaining())
+                            return false;
+
+                        /**
+                         * Grown by doubling as values are read, rather than
+                         * sized by the count: a count is not an element.
+                         **/
+                        AMF0Value* elements = nullptr;
+                        size_t capacity = 0;
+                        depth++;
+                        for (size_t i = 0; i < count; i++)
+                        {
+                            if (i == capacity)
+                            {
+                                size_t grown = capacity ? capacity * 2 : 8;
+                                AMF0Value* larger = static_cast<AMF0Value*>(arena.Allocate(grown * sizeof(AMF0Value)));
+                                for (size_t j = 0; j < i; j++)
+                                    new (&larger[j]) AMF0Value(elements[j]);
+                                elements = larger;
+                                capacity = grown;
+                            }
+
+                            new (&elements[i]) AMF0Value();
+                            if (!Read(elements[i]))
+                            {
+                                depth--;
+                                return false;
+                            }
+                        }
+                        depth--;
+
+                        value.type = AMF0Value::Type::StrictArray;
+                        value.elements = elements;
+                        value.count = count;
+                        return true;
+                    }
+
+                    case 0x0B:
+                        // Milliseconds since the epoch, then a reserved time zone.
+                        value.type = AMF0Value::Type::Date;
+                        if (!ReadNumber(value.number) || Remaining() < 2)
+                            return false;
+                        position += 2;
+                        return true;
+
+                    case 0x05:
+                        value.type = AMF0Value::Type::Null;
+                        return true;
+
+                    case 0x06:
+                    case 0x0D:
+                        value.type = AMF0Value::Type::Undefined;
+                        return true;
+
+                    case 0x11:
+                        return AMF3Decoder::Decode(position, end, arena, references, depth, value);
+
+                    default:
+                        // References, movie clips and record sets.
+                        return false;
+                }
+            }
+    };
+
+    static void WriteLength(vector<char>& output, size_t length, size_t lengthSize)
+    {
+        unsigned char bytes[4];
+        if (lengthSize == 2)
+            Endian::Store16BE(bytes, (uint16_t)length);
+        else
+            Endian::Store32BE(bytes, (uint32_t)length);
+        output.insert(output.end(), bytes, bytes + lengthSize);
+    }
+
+    static void WriteNumber(vector<char>& output, double number)
+    {
+        uint64_t bits;
+        memcpy(&bits, &number, sizeof(bits));
+        unsigned char bytes[8];
+        Endian::Store64BE(bytes, bits);
+        output.insert(output.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    static void WriteProperties(vector<char>& output, const AMF0Value& value)
+    {
+        for (size_t i = 0; i < value.count; i++)
+        {
+            // Names are at most 65535 bytes long in AMF0.
+            string_view key = value.properties[i].key.substr(0, 0xFFFF);
+            WriteLength(output, key.size(), 2);
+            output.insert(output.end(), key.begin(), key.end());
+            AMF0Encoder::Write(output, value.properties[i].value);
+        }
+        output.push_back(0x00);
+        output.push_back(0x00);
+        output.push_back(0x09);
+    }
+
+    void AMF0Encoder::Write(vector<char>& output, const AMF0Value& value)
+    {
+        switch (value.type)
+        {
+            case AMF0Value::Type::Number:
+                output.push_back(0x00);
+                WriteNumber(output, value.number);
+                break;
+
+            case AMF0Value::Type::Boolean:
+                output.push_back(0x01);
+                output.push_back(value.boolean ? 1 : 0);
+                break;
+
+            case AMF0Value::Type::String:
+            case AMF0Value::Type::ByteArray:
+            {
+                bool isLong = value.string.size() > 0xFFFF;
+                output.push_back(isLong ? 0x0C : 0x02);
+                WriteLength(output, value.string.size(), isLong ? 4 : 2);
+                output.insert(output.end(), value.string.begin(), value.string.end());
+                break;
+            }
+
+            case AMF0Value::Type::XmlDocument:
+                output.push_back(0x0F);
+                WriteLength(output, value.string.size(), 4);
+                output.insert(output.end(), value.string.begin(), value.string.end());
+                break;
+
+            case AMF0Value::Type::Object:
+                output.push_back(0x03);
+                WriteProperties(output, value);
+                break;
+
+            case AMF0Value::Type::TypedObject:
+            {
+                string_view className = value.string.substr(0, 0xFFFF);
+                output.push_back(0x10);
+                WriteLength(output, className.size(), 2);
+                output.insert(output.end(), className.begin(), className.end());
+                WriteProperties(output, value);
+                break;
+            }
+
+            case AMF0Value::Type::EcmaArray:
+                output.push_back(0x08);
+                WriteLength(output, value.count, 4);
+                WriteProperties(output, value);
+                break;
+
+            case AMF0Value::Type::StrictArray:
+                output.push_back(0x0A);
+                WriteLength(output, value.count, 4);
+                for (size_t i = 0; i < value.count; i++)
+                    Write(output, value.elements[i]);
+                break;
+
+            case AMF0Value::Type::Date:
+                // No time zone.
+                output.push_back(0x0B);
+                WriteNumber(output, value.number);
+                output.push_back(0x00);
+                output.push_back(0x00);
+                break;
+
+            case AMF0Value::Type::Null:
+                output.push_back(0x05);
+                break;
+
+            case AMF0Value::Type::Undefined:
+                output.push_back(0x06);
+                break;
+        }
+    }
+
+    bool AMF0Decoder::Decode(const unsigned char* data, size_t length, AMF0Arena& arena, const AMF0Value*& values, size_t& count)
+    {
+        AMF0Reader reader(data, length, arena);
+
+        // Grown by doubling, like object properties.
+        AMF0Value* decoded = nullptr;
+        size_t capacity = 0;
+        count = 0;
+
+        while (!reader.AtEnd())
+        {
+            if (count == capacity)
+            {
+                size_t grown = capacity ? capacity * 2 : 8;
+                AMF0Value* larger = static_cast<AMF0Value*>(arena.Allocate(grown * sizeof(AMF0Value)));
+                for (size_t i = 0; i < count; i++)
+                    new (&larger[i]) AMF0Value(decoded[i]);
+                decoded = larger;
+                capacity = grown;
+            }
+
+            new (&decoded[count]) AMF0Value();
+            if (!reader.Read(decoded[count]))
+                return false;
+            count++;
+        }
+
+        values = decoded;
+        return true;
+    }
+
+    bool AMF0Decoder::DecodeCommand(const unsigned char* data, size_t length, AMF0Arena& arena, AMF0Command& command)
+    {
+        const AMF0Value* values = nullptr;
+        size_t count = 0;
+        if (!Decode(data, length, arena, values, count) || count < 1 || !values[0].IsString())
+            return false;
+
+        command.name = values[0].string;
+        command.type = Netconnection::FindCommandType(command.name);
+        command.transactionID = count > 1 && values[1].IsNumber() ? values[1].number : 0;
+        command.arguments = count > 2 ? values + 2 : nullptr;
+        command.argumentCount = count > 2 ? count - 2 : 0;
+        return true;
+    }
+}
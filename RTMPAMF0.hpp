@@ -0,0 +1,176 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Zero-copy AMF0 decoding.
+ **/
+
+#include "Netconnection.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Bump allocator for what is decoded from one message.
+     *
+     * Everything allocated is released at once by Reset. Up to KeptBlocks
+     * blocks of BlockSize are kept for the next message, so that once
+     * warmed up, decoding does not allocate from the heap; larger blocks
+     * are freed, so that one large message does not hold its memory.
+     **/
+    class AMF0Arena
+    {
+        private:
+            struct Block
+            {
+                unsigned char* data;
+                size_t size;
+            };
+
+            vector<Block> blocks;
+
+            // Block allocated from, and bytes used in it.
+            size_t current = 0;
+            size_t used = 0;
+
+        public:
+            static constexpr size_t BlockSize = 4096;
+            static constexpr size_t KeptBlocks = 16;
+
+            AMF0Arena() {};
+            ~AMF0Arena();
+
+            AMF0Arena(const AMF0Arena&) = delete;
+            AMF0Arena& operator=(const AMF0Arena&) = delete;
+
+            /**
+             * `size` bytes aligned for any decoded type, valid until Reset.
+             **/
+            void* Allocate(size_t size);
+
+            void Reset();
+    };
+
+    struct AMF0Property;
+
+    /**
+     * Decoded AMF0 value.
+     *
+     * Strings are views into the decoded message; objects and ECMA arrays
+     * are flat arrays of properties, strict arrays flat arrays of values,
+     * both in the arena. Valid until the message buffer is released or
+     * the arena reset, whichever comes first.
+     **/
+    struct AMF0Value
+    {
+        enum class Type : unsigned char
+        {
+            Number,
+            Boolean,
+            String,
+            Object,
+            Null,
+            Undefined,
+            EcmaArray,
+            StrictArray,
+            Date,
+            XmlDocument,
+            TypedObject,
+
+            // AMF3 only.
+            ByteArray
+        };
+
+        Type type = Type::Undefined;
+        bool boolean = false;
+        double number = 0;
+
+        // String, XmlDocument, ByteArray; class name of a TypedObject.
+        string_view string;
+
+        // Object, EcmaArray, TypedObject.
+        const AMF0Property* properties = nullptr;
+
+        // StrictArray.
+        const AMF0Value* elements = nullptr;
+
+        // Properties or elements.
+        size_t count = 0;
+
+        bool IsNumber() const { return type == Type::Number; }
+        bool IsString() const { return type == Type::String; }
+
+        /**
+         * Property `key` of an object, or nullptr.
+         **/
+        const AMF0Value* Find(string_view key) const;
+    };
+
+    struct AMF0Property
+    {
+        string_view key;
+        AMF0Value value;
+    };
+
+    /**
+     * Command message: name, transaction ID, then the arguments, the
+     * command object first.
+     **/
+    struct AMF0Command
+    {
+        Netconnection::CommandType type = Netconnection::CommandType::Null;
+        string_view name;
+        double transactionID = 0;
+
+        // Encoding of the message it came in, which the responses use.
+        Netconnection::ObjectEncoding encoding = Netconnection::ObjectEncoding::AMF0;
+
+        const AMF0Value* arguments = nullptr;
+        size_t argumentCount = 0;
+
+        /**
+         * Argument `index`, Undefined when not sent.
+         **/
+        const AMF0Value& Argument(size_t index) const;
+    };
+
+    class AMF0Encoder
+    {
+        public:
+            /**
+             * Append `value`. AMF3 byte arrays are written as strings.
+             **/
+            static void Write(vector<char>& output, const AMF0Value& value);
+    };
+
+    class AMF0Decoder
+    {
+        public:
+            /**
+             * Nesting allowed in objects and arrays.
+             **/
+            static constexpr int MaximumDepth = 32;
+
+            /**
+             * Decode the values of `data` in sequence. Returns false if the
+             * data is malformed.
+             *
+             * Values switched to AMF3 (avmplus-object marker) are decoded by
+             * AMF3Decoder, with reference tables shared by the message.
+             **/
+            static bool Decode(const unsigned char* data, size_t length, AMF0Arena& arena, const AMF0Value*& values, size_t& count);
+
+            /**
+             * Decode a command message; the type is resolved from the name
+             * (Netconnection::FindCommandType).
+             **/
+            static bool DecodeCommand(const unsigned char* data, size_t length, AMF0Arena& arena, AMF0Command& command);
+    };
+}
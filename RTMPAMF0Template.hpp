@@ -0,0 +1,182 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * AMF0 messages encoded at compile time.
+ **/
+
+#include "RTMPEndian.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Constant part of an AMF0 message, encoded by a constexpr builder.
+     *
+     * Numbers that change between messages are left as slots: the marker
+     * is encoded, the 8 value bytes are patched into a copy. Strings that
+     * change split a message in several templates, the strings being
+     * appended in between.
+     **/
+    class AMF0Template
+    {
+        public:
+            static constexpr size_t Capacity = 256;
+            static constexpr size_t MaximumSlots = 4;
+
+        private:
+            char bytes[Capacity] = {};
+            size_t length = 0;
+
+            size_t slots[MaximumSlots] = {};
+            size_t slotCount = 0;
+
+            constexpr void Put(unsigned char value)
+            {
+                // Past the capacity, the constant evaluation fails.
+                bytes[length++] = (char)value;
+            }
+
+            constexpr void PutText(const char* text)
+            {
+                size_t size = 0;
+                while (text[size] != '\0')
+                    size++;
+
+                Put((unsigned char)(size >> 8));
+                Put((unsigned char)size);
+                for (size_t i = 0; i < size; i++)
+                    Put((unsigned char)text[i]);
+            }
+
+            /**
+             * IEEE-754 bits of an integer, exact below 2^53.
+             **/
+            static constexpr uint64_t IntegerBits(uint64_t value)
+            {
+                if (value == 0)
+                    return 0;
+
+                int exponent = 63;
+                while (!(value >> exponent))
+                    exponent--;
+
+                uint64_t mantissa = exponent <= 52 ? value << (52 - exponent) : value >> (exponent - 52);
+                return ((uint64_t)(1023 + exponent) << 52) | (mantissa & ((1ULL << 52) - 1));
+            }
+
+        public:
+            constexpr AMF0Template& String(const char* text)
+            {
+                Put(0x02);
+                PutText(text);
+                return *this;
+            }
+
+            /**
+             * Property name, in an object.
+             **/
+            constexpr AMF0Template& Key(const char* text)
+            {
+                PutText(text);
+                return *this;
+            }
+
+            constexpr AMF0Template& Integer(uint64_t value)
+            {
+                Put(0x00);
+                uint64_t bits = IntegerBits(value);
+                for (int shift = 56; shift >= 0; shift -= 8)
+                    Put((unsigned char)(bits >> shift));
+                return *this;
+            }
+
+            /**
+             * Number patched in every copy (see PatchNumber).
+             **/
+            constexpr AMF0Template& NumberSlot()
+            {
+                slots[slotCount++] = length;
+                return Integer(0);
+            }
+
+            constexpr AMF0Template& Null()
+            {
+                Put(0x05);
+                return *this;
+            }
+
+            constexpr AMF0Template& ObjectStart()
+            {
+                Put(0x03);
+                return *this;
+            }
+
+            constexpr AMF0Template& ObjectEnd()
+            {
+                Put(0x00);
+                Put(0x00);
+                Put(0x09);
+                return *this;
+            }
+
+            constexpr const char* Data() const { return bytes; }
+            constexpr size_t Length() const { return length; }
+
+            /**
+             * Offset of number slot `index` in the template.
+             **/
+            constexpr size_t Slot(size_t index) const { return slots[index]; }
+
+            /**
+             * Append the template to `destination`. Returns the offset it starts at.
+             **/
+            size_t AppendTo(vector<char>& destination) const
+            {
+                size_t offset = destination.size();
+                destination.insert(destination.end(), bytes, bytes + length);
+                return offset;
+            }
+
+            /**
+             * Set the number at `offset`, a slot of a copied template.
+             **/
+            static void PatchNumber(vector<char>& data, size_t offset, double value)
+            {
+                uint64_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                Endian::Store64BE(reinterpret_cast<unsigned char*>(data.data() + offset + 1), bits);
+            }
+
+            /**
+             * Append a string value, long string past 65535 bytes.
+             **/
+            static void AppendString(vector<char>& destination, const string& text)
+            {
+                unsigned char header[5];
+                size_t headerLength;
+                if (text.size() <= 0xFFFF)
+                {
+                    header[0] = 0x02;
+                    Endian::Store16BE(header + 1, (uint16_t)text.size());
+                    headerLength = 3;
+                }
+                else
+                {
+                    header[0] = 0x0C;
+                    Endian::Store32BE(header + 1, (uint32_t)text.size());
+                    headerLength = 5;
+                }
+                destination.insert(destination.end(), header, header + headerLength);
+                destination.insert(destination.end(), text.begin(), text.end());
+            }
+    };
+}
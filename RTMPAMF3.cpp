@@ -0,0 +1,663 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of AMF3 encoding and decoding.
+ **/
+
+#include "RTMPAMF3.hpp"
+#include "RTMPEndian.hpp"
+
+#include <cmath>
+#include <cstring>
+
+namespace RTMP
+{
+    /**
+     * Values grown by doubling in the arena, like AMF0 object properties.
+     **/
+    template<typename T>
+    class AMF3List
+    {
+        private:
+            T* items = nullptr;
+            size_t count = 0;
+            size_t capacity = 0;
+
+        public:
+            T* Data() const { return items; }
+            size_t Count() const { return count; }
+
+            T& Add(AMF0Arena& arena)
+            {
+                if (count == capacity)
+                {
+                    size_t grown = capacity ? capacity * 2 : 8;
+                    T* larger = static_cast<T*>(arena.Allocate(grown * sizeof(T)));
+                    for (size_t i = 0; i < count; i++)
+                        new (&larger[i]) T(items[i]);
+                    items = larger;
+                    capacity = grown;
+                }
+                return *new (&items[count++]) T();
+            }
+    };
+
+    /**
+     * Reads one AMF3 value, bounds-checked.
+     **/
+    class AMF3Reader
+    {
+        private:
+            const unsigned char*& position;
+            const unsigned char* end;
+            AMF0Arena& arena;
+            AMF3References& references;
+            int depth;
+
+            size_t Remaining() const { return (size_t)(end - position); }
+
+            /**
+             * Variable length 29-bit integer: 7 bits per byte while the
+             * high bit is set, all 8 bits of a fourth byte.
+             **/
+            bool ReadU29(uint32_t& value)
+            {
+                value = 0;
+                for (int i = 0; i < 4; i++)
+                {
+                    if (Remaining() < 1)
+                        return false;
+                    unsigned char byte = *position++;
+                    if (i == 3)
+                    {
+                        value = (value << 8) | byte;
+                        return true;
+                    }
+                    value = (value << 7) | (byte & 0x7F);
+                    if (!(byte & 0x80))
+                        return true;
+                }
+                return true;
+            }
+
+            bool ReadDouble(double& number)
+            {
+                if (Remaining() < 8)
+                    return false;
+                uint64_t bits = Endian::Load64BE(position);
+                memcpy(&number, &bits, sizeof(number));
+                position += 8;
+                return true;
+            }
+
+            bool ReadBytes(uint32_t length, string_view& text)
+            {
+                if (Remaining() < length)
+                    return false;
+                text = string_view(reinterpret_cast<const char*>(position), length);
+                position += length;
+                return true;
+            }
+
+            bool ReadString(string_view& text)
+            {
+                uint32_t header;
+                if (!ReadU29(header))
+                    return false;
+
+                if (!(header & 1))
+                {
+                    const string_view* referenced = references.strings.Get(header >> 1);
+                    if (referenced == nullptr)
+                        return false;
+                    text = *referenced;
+                    return true;
+                }
+
+                if (!ReadBytes(header >> 1, text))
+                    return false;
+
+                // The empty string is never sent by reference.
+                if (!text.empty())
+                    references.strings.Add(arena, text);
+                return true;
+            }
+
+            /**
+             * Header of a value of the object table. Sets `value` if it is
+             * a reference.
+             **/
+            bool ReadHeader(uint32_t& header, AMF0Value& value, bool& referenced)
+            {
+                if (!ReadU29(header))
+                    return false;
+
+                referenced = !(header & 1);
+                if (!referenced)
+                    return true;
+
+                const AMF0Value* object = references.objects.Get(header >> 1);
+                if (object == nullptr)
+                    return false;
+                value = *object;
+                return true;
+            }
+
+            bool ReadTraits(uint32_t header, AMF3Traits& traits)
+            {
+                if (!(header & 2))
+                {
+                    const AMF3Traits* referenced = references.traits.Get(header >> 2);
+                    if (referenced == nullptr)
+                        return false;
+                    traits = *referenced;
+                    return true;
+                }
+
+                // Externalizable: the class alone knows how it is written.
+                if (header & 4)
+                    return false;
+
+                traits.dynamic = (header & 8) != 0;
+                traits.memberCount = header >> 4;
+                if (!ReadString(traits.className))
+                    return false;
+
+                // Every name takes a byte at least: bounds the allocation.
+                if (traits.memberCount > Remaining())
+                    return false;
+
+                string_view* members = static_cast<string_view*>(arena.Allocate(traits.memberCount * sizeof(string_view)));
+                for (size_t i = 0; i < traits.memberCount; i++)
+                {
+                    new (&members[i]) string_view();
+                    if (!ReadString(members[i]))
+                        return false;
+                }
+                traits.members = members;
+
+                references.traits.Add(arena, traits);
+                return true;
+            }
+
+            bool ReadObject(uint32_t header, AMF0Value& value)
+            {
+                AMF3Traits traits;
+                if (!ReadTraits(header, traits))
+                    return false;
+
+                value.type = traits.className.empty() ? AMF0Value::Type::Object : AMF0Value::Type::TypedObject;
+                value.string = traits.className;
+
+                AMF3List<AMF0Property> properties;
+                for (size_t i = 0; i < traits.memberCount; i++)
+                {
+                    AMF0Property& property = properties.Add(arena);
+                    property.key = traits.members[i];
+                    if (!Read(property.value))
+                        return false;
+                }
+
+                // Dynamic members, up to the empty name.
+                while (traits.dynamic)
+                {
+                    string_view key;
+                    if (!ReadString(key))
+                        return false;
+                    if (key.empty())
+                        break;
+
+                    AMF0Property& property = properties.Add(arena);
+                    property.key = key;
+                    if (!Read(property.value))
+                        return false;
+                }
+
+                value.properties = properties.Data();
+                value.count = properties.Count();
+                return true;
+            }
+
+            bool ReadArray(uint32_t header, AMF0Value& value)
+            {
+                size_t denseCount = header >> 1;
+
+                // Named entries first, up to the empty name.
+                AMF3List<AMF0Property> properties;
+                for (;;)
+                {
+                    string_view key;
+                    if (!ReadString(key))
+                        return false;
+                    if (key.empty())
+                        break;
+
+                    AMF0Property& property = properties.Add(arena);
+                    property.key = key;
+                    if (!Read(property.value))
+                        return false;
+                }
+
+                // Every value takes a byte at least.
+                if (denseCount > Remaining())
+                    return false;
+
+                // Grown as values are read, rather than sized by the count.
+                if (properties.Count() == 0)
+                {
+                    AMF3List<AMF0Value> elements;
+                    for (size_t i = 0; i < denseCount; i++)
+                    {
+                        if (!Read(elements.Add(arena)))
+                            return false;
+                    }
+
+                    value.type = AMF0Value::Type::StrictArray;
+                    value.elements = elements.Data();
+                    value.count = elements.Count();
+                    return true;
+                }
+
+                // Both: an ECMA array, the dense part keyed by index.
+                for (size_t i = 0; i < denseCount; i++)
+                {
+                    char* key = static_cast<char*>(arena.Allocate(20));
+                    size_t length = 0;
+                    size_t index = i;
+                    do
+                    {
+                        key[length++] = (char)('0' + index % 10);
+                        index /= 10;
+                    } while (index > 0);
+                    for (size_t j = 0; j < length / 2; j++)
+                        swap(key[j], key[length - 1 - j]);
+
+                    AMF0Property& property = properties.Add(arena);
+                    property.key = string_view(key, length);
+                    if (!Read(property.value))
+                        return false;
+                }
+
+                value.type = AMF0Value::Type::EcmaArray;
+                value.properties = properties.Data();
+                value.count = properties.Count();
+                return true;
+            }
+
+            /**
+             * Vector of int (0x0D), uint (0x0E), double (0x0F) or objects
+             * (0x10), as a strict array.
+             **/
+            bool ReadVector(unsigned char marker, uint32_t header, AMF0Value& value)
+            {
+                size_t count = header >> 1;
+
+                // Fixed length flag.
+                if (Remaining() < 1)
+                    return false;
+                position++;
+
+                string_view typeName;
+                if (marker == 0x10 && !ReadString(typeName))
+                    return false;
+
+                size_t elementSize = marker == 0x0F ? 8 : marker == 0x10 ? 1 : 4;
+                if (count > Remaining() / elementSize)
+                    return false;
+
+                AMF3List<AMF0Value> elements;
+                for (size_t i = 0; i < count; i++)
+                {
+                    AMF0Value& element = elements.Add(arena);
+                    if (marker == 0x10)
+                    {
+                        if (!Read(element))
+                            return false;
+                        continue;
+                    }
+
+                    element.type = AMF0Value::Type::Number;
+                    if (marker == 0x0F)
+                    {
+                        if (!ReadDouble(element.number))
+                            return false;
+                        continue;
+                    }
+
+                    uint32_t bits = Endian::Load32BE(position);
+                    position += 4;
+                    element.number = marker == 0x0D ? (double)(int32_t)bits : (double)bits;
+                }
+
+                value.type = AMF0Value::Type::StrictArray;
+                value.elements = elements.Data();
+                value.count = elements.Count();
+                return true;
+            }
+
+        public:
+            AMF3Reader(const unsigned char*& position, const unsigned char* end, AMF0Arena& arena, AMF3References& references, int depth)
+                : position(position), end(end), arena(arena), references(references), depth(depth) {};
+
+            bool Read(AMF0Value& value)
+            {
+                if (Remaining() < 1 || depth >= AMF0Decoder::MaximumDepth)
+                    return false;
+
+                unsigned char marker = *position++;
+                switch (marker)
+                {
+                    case 0x00:
+                        value.type = AMF0Value::Type::Undefined;
+                        return true;
+
+                    case 0x01:
+                        value.type = AMF0Value::Type::Null;
+                        return true;
+
+                    case 0x02:
+                    case 0x03:
+                        value.type = AMF0Value::Type::Boolean;
+                        value.boolean = marker == 0x03;
+                        return true;
+
+                    case 0x04:
+                    {
+                        uint32_t bits;
+                        if (!ReadU29(bits))
+                            return false;
+
+                        // Signed 29 bits.
+                        value.type = AMF0Value::Type::Number;
+                        value.number = (double)(bits & 0x10000000 ? (int32_t)(bits | 0xE0000000) : (int32_t)bits);
+                        return true;
+                    }
+
+                    case 0x05:
+                        value.type = AMF0Value::Type::Number;
+                        return ReadDouble(value.number);
+
+                    case 0x06:
+                        value.type = AMF0Value::Type::String;
+                        return ReadString(value.string);
+
+                    case 0x07:
+                    case 0x0B:
+                    case 0x0C:
+                    case 0x08:
+                    {
+                        uint32_t header;
+                        bool referenced;
+                        if (!ReadHeader(header, value, referenced))
+                            return false;
+                        if (referenced)
+                            return true;
+
+                        if (marker == 0x08)
+                        {
+                            value.type = AMF0Value::Type::Date;
+                            if (!ReadDouble(value.number))
+                                return false;
+                        }
+                        else
+                        {
+                            value.type = marker == 0x0C ? AMF0Value::Type::ByteArray : AMF0Value::Type::XmlDocument;
+                            if (!ReadBytes(header >> 1, value.string))
+                                return false;
+                        }
+                        references.objects.Add(arena, value);
+                        return true;
+                    }
+
+                    case 0x09:
+                    case 0x0A:
+                    case 0x0D:
+                    case 0x0E:
+                    case 0x0F:
+                    case 0x10:
+                    {
+                        uint32_t header;
+                        bool referenced;
+                        if (!ReadHeader(header, value, referenced))
+                            return false;
+                        if (referenced)
+                            return true;
+
+                        // Indexed before its members; set once complete.
+                        size_t index = references.objects.Count();
+                        AMF0Value placeholder;
+                        placeholder.type = AMF0Value::Type::Null;
+                        references.objects.Add(arena, placeholder);
+
+                        depth++;
+                        bool read = marker == 0x09 ? ReadArray(header, value)
+                            : marker == 0x0A ? ReadObject(header, value)
+                            : ReadVector(marker, header, value);
+                        depth--;
+
+                        if (read)
+                            references.objects.Set(index, value);
+                        return read;
+                    }
+
+                    default:
+                        // Dictionaries.
+                        return false;
+                }
+            }
+    };
+
+    bool AMF3Decoder::Decode(const unsigned char*& position, const unsigned char* end, AMF0Arena& arena, AMF3References& references, int depth, AMF0Value& value)
+    {
+        AMF3Reader reader(position, end, arena, references, depth);
+        return reader.Read(value);
+    }
+
+    void AMF3Encoder::WriteU29(uint32_t value)
+    {
+        value &= 0x1FFFFFFF;
+        if (value < 0x80)
+        {
+            output.push_back((char)value);
+        }
+        else if (value < 0x4000)
+        {
+            output.push_back((char)(0x80 | (value >> 7)));
+            output.push_back((char)(value & 0x7F));
+        }
+        else if (value < 0x200000)
+        {
+            output.push_back((char)(0x80 | (value >> 14)));
+            output.push_back((char)(0x80 | ((value >> 7) & 0x7F)));
+            output.push_back((char)(value & 0x7F));
+        }
+        else
+        {
+            output.push_back((char)(0x80 | (value >> 22)));
+            output.push_back((char)(0x80 | ((value >> 15) & 0x7F)));
+            output.push_back((char)(0x80 | ((value >> 8) & 0x7F)));
+            output.push_back((char)value);
+        }
+    }
+
+    void AMF3Encoder::WriteDouble(double value)
+    {
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        unsigned char bytes[8];
+        Endian::Store64BE(bytes, bits);
+        output.insert(output.end(), bytes, bytes + sizeof(bytes));
+    }
+
+    void AMF3Encoder::WriteString(string_view text)
+    {
+        if (text.empty())
+        {
+            WriteU29(1);
+            return;
+        }
+
+        auto found = strings.find(text);
+        if (found != strings.end())
+        {
+            WriteU29(found->second << 1);
+            return;
+        }
+
+        if (stringCount < AMF3Table<string_view>::MaximumReferences)
+            strings.emplace(text, stringCount);
+        stringCount++;
+
+        WriteU29((uint32_t)(text.size() << 1) | 1);
+        output.insert(output.end(), text.begin(), text.end());
+    }
+
+    bool AMF3Encoder::WriteReference(const void* identity)
+    {
+        // Empty objects have nothing to tell them apart.
+        if (identity != nullptr)
+        {
+            auto found = objects.find(identity);
+            if (found != objects.end())
+            {
+                WriteU29(found->second << 1);
+                return true;
+            }
+            if (objectCount < AMF3Table<AMF0Value>::MaximumReferences)
+                objects.emplace(identity, objectCount);
+        }
+        objectCount++;
+        return false;
+    }
+
+    void AMF3Encoder::WriteObject(const AMF0Value& value)
+    {
+        output.push_back(0x0A);
+        if (WriteReference(value.properties))
+            return;
+
+        string shape(value.string);
+        shape.push_back('\0');
+        for (size_t i = 0; i < value.count; i++)
+        {
+            shape.append(value.properties[i].key);
+            shape.push_back('\0');
+        }
+
+        auto found = traits.find(shape);
+        if (found != traits.end())
+        {
+            // Object, traits by reference.
+            WriteU29((found->second << 2) | 1);
+        }
+        else
+        {
+            if (traitCount < AMF3Table<AMF3Traits>::MaximumReferences)
+                traits.emplace(move(shape), traitCount);
+            traitCount++;
+
+            // Object, inline sealed traits.
+            WriteU29((uint32_t)(value.count << 4) | 3);
+            WriteString(value.string);
+            for (size_t i = 0; i < value.count; i++)
+                WriteString(value.properties[i].key);
+        }
+
+        for (size_t i = 0; i < value.count; i++)
+            Write(value.properties[i].value);
+    }
+
+    void AMF3Encoder::WriteArray(const AMF0Value& value)
+    {
+        output.push_back(0x09);
+
+        if (value.type == AMF0Value::Type::StrictArray)
+        {
+            if (WriteReference(value.elements))
+                return;
+            WriteU29((uint32_t)(value.count << 1) | 1);
+            WriteString("");
+            for (size_t i = 0; i < value.count; i++)
+                Write(value.elements[i]);
+            return;
+        }
+
+        // All named entries.
+        if (WriteReference(value.properties))
+            return;
+        WriteU29(1);
+        for (size_t i = 0; i < value.count; i++)
+        {
+            WriteString(value.properties[i].key);
+            Write(value.properties[i].value);
+        }
+        WriteString("");
+    }
+
+    void AMF3Encoder::Write(const AMF0Value& value)
+    {
+        switch (value.type)
+        {
+            case AMF0Value::Type::Number:
+            {
+                // Integers of 29 bits, other numbers as doubles.
+                double number = value.number;
+                if (number >= -268435456.0 && number <= 268435455.0 && number == (double)(int32_t)number
+                    && !(number == 0 && signbit(number)))
+                {
+                    output.push_back(0x04);
+                    WriteU29((uint32_t)(int32_t)number);
+                }
+                else
+                {
+                    output.push_back(0x05);
+                    WriteDouble(number);
+                }
+                break;
+            }
+
+            case AMF0Value::Type::Boolean:
+                output.push_back(value.boolean ? 0x03 : 0x02);
+                break;
+
+            case AMF0Value::Type::String:
+                output.push_back(0x06);
+                WriteString(value.string);
+                break;
+
+            case AMF0Value::Type::Object:
+            case AMF0Value::Type::TypedObject:
+                WriteObject(value);
+                break;
+
+            case AMF0Value::Type::EcmaArray:
+            case AMF0Value::Type::StrictArray:
+                WriteArray(value);
+                break;
+
+            case AMF0Value::Type::Date:
+                output.push_back(0x08);
+                WriteReference(nullptr);
+                WriteU29(1);
+                WriteDouble(value.number);
+                break;
+
+            case AMF0Value::Type::XmlDocument:
+            case AMF0Value::Type::ByteArray:
+                output.push_back(value.type == AMF0Value::Type::XmlDocument ? 0x07 : 0x0C);
+                WriteReference(nullptr);
+                WriteU29((uint32_t)(value.string.size() << 1) | 1);
+                output.insert(output.end(), value.string.begin(), value.string.end());
+                break;
+
+            case AMF0Value::Type::Null:
+                output.push_back(0x01);
+                break;
+
+            case AMF0Value::Type::Undefined:
+                output.push_back(0x00);
+                break;
+        }
+    }
+}
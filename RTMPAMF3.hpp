@@ -0,0 +1,159 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * AMF3 encoding and decoding, with reference tables.
+ **/
+
+#include "RTMPAMF0.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Reference table in an arena.
+     *
+     * Every entry takes an index, but only the first MaximumReferences are
+     * kept: a reference past them is rejected, so that a message cannot
+     * make the table grow much larger than itself.
+     **/
+    template<typename T>
+    class AMF3Table
+    {
+        private:
+            T* items = nullptr;
+            size_t stored = 0;
+            size_t capacity = 0;
+            size_t count = 0;
+
+        public:
+            static constexpr size_t MaximumReferences = 1024;
+
+            size_t Count() const { return count; }
+
+            void Add(AMF0Arena& arena, const T& item)
+            {
+                if (stored < MaximumReferences)
+                {
+                    if (stored == capacity)
+                    {
+                        size_t grown = capacity ? capacity * 2 : 8;
+                        T* larger = static_cast<T*>(arena.Allocate(grown * sizeof(T)));
+                        for (size_t i = 0; i < stored; i++)
+                            new (&larger[i]) T(items[i]);
+                        items = larger;
+                        capacity = grown;
+                    }
+                    new (&items[stored++]) T(item);
+                }
+                count++;
+            }
+
+            /**
+             * Entry `index`, or nullptr if it was not kept.
+             **/
+            const T* Get(size_t index) const { return index < stored ? &items[index] : nullptr; }
+
+            void Set(size_t index, const T& item)
+            {
+                if (index < stored)
+                    items[index] = item;
+            }
+    };
+
+    /**
+     * Class name and sealed member names of an object.
+     **/
+    struct AMF3Traits
+    {
+        string_view className;
+        const string_view* members = nullptr;
+        size_t memberCount = 0;
+        bool dynamic = false;
+    };
+
+    /**
+     * Reference tables of one message, shared by all of its AMF3 values.
+     **/
+    struct AMF3References
+    {
+        AMF3Table<string_view> strings;
+        AMF3Table<AMF0Value> objects;
+        AMF3Table<AMF3Traits> traits;
+    };
+
+    class AMF3Decoder
+    {
+        public:
+            /**
+             * Decode the AMF3 value at `position`, which follows an AMF0
+             * avmplus-object marker, and move `position` past it. Returns
+             * false if the data is malformed.
+             *
+             * The value is decoded as AMF0 would have it: integers are
+             * numbers, arrays with named entries ECMA arrays, vectors
+             * strict arrays. Externalizable objects and dictionaries are
+             * not supported. A reference to an object still being decoded
+             * (a cycle) reads as null.
+             **/
+            static bool Decode(const unsigned char*& position, const unsigned char* end, AMF0Arena& arena, AMF3References& references, int depth, AMF0Value& value);
+    };
+
+    /**
+     * Writes values as AMF3, sending strings, objects and object shapes
+     * seen before in the message as references to them.
+     *
+     * Objects are written with sealed traits, their property names, so
+     * that objects of the same shape only write their values. Use one
+     * encoder per message.
+     **/
+    class AMF3Encoder
+    {
+        private:
+            vector<char>& output;
+
+            unordered_map<string_view, uint32_t> strings;
+            uint32_t stringCount = 0;
+
+            // Class name, then the member names, each followed by a null character.
+            unordered_map<string, uint32_t> traits;
+            uint32_t traitCount = 0;
+
+            // Properties or elements of the objects written.
+            unordered_map<const void*, uint32_t> objects;
+            uint32_t objectCount = 0;
+
+            void WriteU29(uint32_t value);
+            void WriteDouble(double value);
+            void WriteString(string_view text);
+
+            /**
+             * Object or array header: reference to `identity` if written
+             * before, else takes the next index. Returns true if a
+             * reference was written.
+             **/
+            bool WriteReference(const void* identity);
+
+            void WriteObject(const AMF0Value& value);
+            void WriteArray(const AMF0Value& value);
+
+        public:
+            AMF3Encoder(vector<char>& output) : output(output) {};
+
+            /**
+             * Append `value`, without the AMF0 avmplus-object marker.
+             * Values must stay valid until the encoder is destroyed.
+             **/
+            void Write(const AMF0Value& value);
+    };
+}
@@ -0,0 +1,132 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the receive ring buffer.
+ **/
+
+#include "RTMPBuffer.hpp"
+
+#include <cstring>
+
+namespace RTMP
+{
+    static size_t RoundUpPowerOfTwo(size_t value)
+    {
+        size_t result = 1;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    void BufferView::CopyTo(unsigned char* destination) const
+    {
+        if (firstLength)
+            memcpy(destination, first, firstLength);
+        if (secondLength)
+            memcpy(destination + firstLength, second, secondLength);
+    }
+
+    bool BufferView::Equals(const unsigned char* data) const
+    {
+        if (firstLength && memcmp(first, data, firstLength) != 0)
+            return false;
+        return secondLength == 0 || memcmp(second, data + firstLength, secondLength) == 0;
+    }
+
+    RingBuffer::RingBuffer(size_t capacity)
+    {
+        this->capacity = RoundUpPowerOfTwo(capacity);
+        storage = new unsigned char[this->capacity];
+    }
+
+    RingBuffer::~RingBuffer()
+    {
+        delete[] storage;
+    }
+
+    void RingBuffer::Reserve(size_t length)
+    {
+        if (length <= capacity)
+            return;
+
+        size_t size = Size();
+        size_t newCapacity = RoundUpPowerOfTwo(length);
+        unsigned char* newStorage = new unsigned char[newCapacity];
+
+        // Linearize readable bytes at the start of the new storage.
+        Peek(0, size).CopyTo(newStorage);
+
+        delete[] storage;
+        storage = newStorage;
+        capacity = newCapacity;
+        head = 0;
+        tail = size;
+    }
+
+    unsigned char* RingBuffer::WritableRegion(size_t& length)
+    {
+        size_t position = tail & (capacity - 1);
+        size_t untilEnd = capacity - position;
+        size_t available = Available();
+
+        length = available < untilEnd ? available : untilEnd;
+        return storage + position;
+    }
+
+    void RingBuffer::Commit(size_t length)
+    {
+        tail += length;
+    }
+
+    void RingBuffer::Write(const unsigned char* data, size_t length)
+    {
+        Reserve(Size() + length);
+
+        while (length > 0)
+        {
+            size_t region = 0;
+            unsigned char* destination = WritableRegion(region);
+            if (region > length)
+                region = length;
+
+            memcpy(destination, data, region);
+            Commit(region);
+
+            data += region;
+            length -= region;
+        }
+    }
+
+    BufferView RingBuffer::Peek(size_t offset, size_t length) const
+    {
+        BufferView view;
+        if (length == 0)
+            return view;
+
+        size_t position = (head + offset) & (capacity - 1);
+        size_t untilEnd = capacity - position;
+
+        view.first = storage + position;
+        if (length <= untilEnd)
+        {
+            view.firstLength = length;
+        }
+        else
+        {
+            view.firstLength = untilEnd;
+            view.second = storage;
+            view.secondLength = length - untilEnd;
+        }
+        return view;
+    }
+
+    void RingBuffer::Consume(size_t length)
+    {
+        head += length;
+
+        // Rewind when drained so that the next read lands in one contiguous region.
+        if (head == tail)
+            head = tail = 0;
+    }
+}
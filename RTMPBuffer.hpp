@@ -0,0 +1,106 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Per-session receive and send ring buffers.
+ **/
+
+#include <cstddef>
+
+namespace RTMP
+{
+    /**
+     * View over bytes held by a RingBuffer.
+     *
+     * A view never owns its bytes; it stays valid until the bytes
+     * are consumed from the ring buffer. When the viewed range wraps
+     * around the end of the storage, the view is split in two segments.
+     **/
+    struct BufferView
+    {
+        unsigned char* first = nullptr;
+        size_t firstLength = 0;
+
+        unsigned char* second = nullptr;
+        size_t secondLength = 0;
+
+        size_t Length() const { return firstLength + secondLength; }
+        bool Contiguous() const { return secondLength == 0; }
+
+        /**
+         * Copy the viewed bytes to a linear destination of at least Length() bytes.
+         **/
+        void CopyTo(unsigned char* destination) const;
+
+        /**
+         * Compare the viewed bytes with Length() bytes of `data`.
+         **/
+        bool Equals(const unsigned char* data) const;
+    };
+
+    /**
+     * Byte ring buffer with a power of two capacity.
+     *
+     * Socket reads are committed directly into the storage (WritableRegion/Commit),
+     * the parser then reads through views and consumes what it has handled.
+     * Read and write positions are monotonic counters, masked on access.
+     **/
+    class RingBuffer
+    {
+        private:
+            unsigned char* storage = nullptr;
+            size_t capacity = 0;
+            size_t head = 0;
+            size_t tail = 0;
+
+        public:
+            // Kept small so that idle sessions stay cheap; grows on demand.
+            static constexpr size_t DefaultCapacity = 4 * 1024;
+
+            RingBuffer(size_t capacity = DefaultCapacity);
+            ~RingBuffer();
+
+            RingBuffer(const RingBuffer&) = delete;
+            RingBuffer& operator=(const RingBuffer&) = delete;
+
+            /**
+             * Readable bytes.
+             **/
+            size_t Size() const { return tail - head; }
+            size_t Capacity() const { return capacity; }
+            size_t Available() const { return capacity - Size(); }
+            bool Empty() const { return head == tail; }
+
+            /**
+             * Grow the storage so that at least `length` bytes can be held.
+             * Readable bytes are preserved; views taken before are invalidated.
+             **/
+            void Reserve(size_t length);
+
+            /**
+             * Largest contiguous free region, for reading a socket in place.
+             * Bytes written there become readable once committed.
+             **/
+            unsigned char* WritableRegion(size_t& length);
+            void Commit(size_t length);
+
+            /**
+             * Append bytes, growing the storage if needed.
+             **/
+            void Write(const unsigned char* data, size_t length);
+
+            /**
+             * View `length` readable bytes starting `offset` bytes after the read position.
+             * The caller must make sure offset + length <= Size().
+             **/
+            BufferView Peek(size_t offset, size_t length) const;
+
+            unsigned char At(size_t offset) const { return storage[(head + offset) & (capacity - 1)]; }
+
+            /**
+             * Release `length` bytes from the read position.
+             **/
+            void Consume(size_t length);
+    };
+}
@@ -0,0 +1,137 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the message buffer pool.
+ **/
+
+#include "RTMPBufferPool.hpp"
+
+#include <new>
+
+namespace RTMP
+{
+    size_t BufferPool::SizeClass(size_t length)
+    {
+        size_t sizeClass = 0;
+        while (((size_t)1 << (sizeClass + MinimumClassShift)) < length)
+            sizeClass++;
+        return sizeClass;
+    }
+
+    BufferPool::~BufferPool()
+    {
+        CollectRemoteFrees();
+
+        for (size_t i = 0; i < ClassCount; i++)
+        {
+            while (MessageBuffer* buffer = freeLists[i])
+            {
+                freeLists[i] = buffer->next;
+                ::operator delete(buffer);
+            }
+        }
+    }
+
+    MessageBuffer* BufferPool::Acquire(size_t length)
+    {
+        size_t sizeClass = SizeClass(length);
+
+        // Larger than any size class; allocated for this message only.
+        references.fetch_add(1, memory_order_relaxed);
+
+        if (sizeClass >= ClassCount)
+        {
+            MessageBuffer* buffer = new (::operator new(sizeof(MessageBuffer) + length)) MessageBuffer;
+            buffer->pool = this;
+            buffer->capacity = length;
+            return buffer;
+        }
+
+        if (freeLists[sizeClass] == nullptr)
+            CollectRemoteFrees();
+
+        MessageBuffer* buffer = freeLists[sizeClass];
+        if (buffer != nullptr)
+        {
+            freeLists[sizeClass] = buffer->next;
+            freeCounts[sizeClass]--;
+            buffer->next = nullptr;
+            buffer->length = 0;
+            return buffer;
+        }
+
+        size_t capacity = (size_t)1 << (sizeClass + MinimumClassShift);
+        buffer = new (::operator new(sizeof(MessageBuffer) + capacity)) MessageBuffer;
+        buffer->pool = this;
+        buffer->capacity = capacity;
+        return buffer;
+    }
+
+    void BufferPool::Release(MessageBuffer* buffer)
+    {
+        if (buffer == nullptr)
+            return;
+
+        if (!abandoned.load(memory_order_acquire) && owner == this_thread::get_id())
+        {
+            ReleaseLocal(buffer);
+            Unreference();
+            return;
+        }
+
+        // Released by another thread, to an unbound pool, or after the owner left: hand it back.
+        MessageBuffer* head = remoteFrees.load(memory_order_relaxed);
+        do
+        {
+            buffer->next = head;
+        } while (!remoteFrees.compare_exchange_weak(head, buffer, memory_order_release, memory_order_relaxed));
+        Unreference();
+    }
+
+    void BufferPool::Unreference()
+    {
+        if (references.fetch_sub(1, memory_order_acq_rel) == 1)
+            delete this;
+    }
+
+    void BufferPool::Abandon()
+    {
+        abandoned.store(true, memory_order_release);
+        Unreference();
+    }
+
+    void BufferPool::ReleaseLocal(MessageBuffer* buffer)
+    {
+        size_t sizeClass = SizeClass(buffer->capacity);
+        if (sizeClass >= ClassCount || freeCounts[sizeClass] >= MaximumFreeBuffers)
+        {
+            ::operator delete(buffer);
+            return;
+        }
+
+        buffer->next = freeLists[sizeClass];
+        freeLists[sizeClass] = buffer;
+        freeCounts[sizeClass]++;
+    }
+
+    void BufferPool::CollectRemoteFrees()
+    {
+        if (remoteFrees.load(memory_order_relaxed) == nullptr)
+            return;
+
+        MessageBuffer* buffer = remoteFrees.exchange(nullptr, memory_order_acquire);
+        while (buffer != nullptr)
+        {
+            MessageBuffer* next = buffer->next;
+            ReleaseLocal(buffer);
+            buffer = next;
+        }
+    }
+
+    BufferPool& BufferPool::Default()
+    {
+        static BufferPool pool;
+        return pool;
+    }
+}
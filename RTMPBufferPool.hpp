@@ -0,0 +1,128 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Pooled message buffers.
+ **/
+
+#include <atomic>
+#include <cstddef>
+#include <thread>
+
+using namespace std;
+
+namespace RTMP
+{
+    class BufferPool;
+
+    /**
+     * Buffer holding a complete message payload.
+     * The payload bytes follow the structure in the same allocation.
+     **/
+    struct MessageBuffer
+    {
+        /**
+         * Owning pool, the buffer returns to it when released.
+         **/
+        BufferPool* pool = nullptr;
+
+        /**
+         * Usable bytes, always the size of the buffer's size class.
+         **/
+        size_t capacity = 0;
+
+        /**
+         * Bytes currently held.
+         **/
+        size_t length = 0;
+
+        /**
+         * Free list link.
+         **/
+        MessageBuffer* next = nullptr;
+
+        unsigned char* Data() { return reinterpret_cast<unsigned char*>(this + 1); }
+    };
+
+    /**
+     * Free lists of message buffers, by power of two size class.
+     *
+     * A message costs a single allocation: its buffer is acquired with the
+     * full message length announced by the first chunk, and reused for
+     * later messages of the same size class once released.
+     *
+     * A pool bound to a thread is only acquired from by that thread. Buffers
+     * released by other threads, or while the pool is not bound yet, are
+     * pushed on a lock-free list and taken back when the free list of their
+     * size class runs dry. Transports bind their pool when they start.
+     *
+     * Buffers may outlive their owner: a pool given up with Abandon is only
+     * freed once the last of its buffers is released.
+     **/
+    class BufferPool
+    {
+        private:
+            /**
+             * Size classes from 256 bytes to 16 MB, the largest RTMP message.
+             **/
+            static constexpr size_t MinimumClassShift = 8;
+            static constexpr size_t ClassCount = 17;
+
+            /**
+             * Released buffers kept per size class, the rest are freed.
+             **/
+            static constexpr size_t MaximumFreeBuffers = 32;
+
+            MessageBuffer* freeLists[ClassCount] = {};
+            size_t freeCounts[ClassCount] = {};
+
+            /**
+             * Buffers released by other threads than the owner.
+             **/
+            atomic<MessageBuffer*> remoteFrees { nullptr };
+            thread::id owner;
+
+            /**
+             * The owner's, plus one per buffer acquired and not released.
+             **/
+            atomic<size_t> references { 1 };
+            atomic<bool> abandoned { false };
+
+            void Unreference();
+
+            static size_t SizeClass(size_t length);
+
+            void ReleaseLocal(MessageBuffer* buffer);
+            void CollectRemoteFrees();
+
+        public:
+            BufferPool() {};
+            ~BufferPool();
+
+            BufferPool(const BufferPool&) = delete;
+            BufferPool& operator=(const BufferPool&) = delete;
+
+            /**
+             * Buffer able to hold at least `length` bytes, with a length of 0.
+             **/
+            MessageBuffer* Acquire(size_t length);
+            void Release(MessageBuffer* buffer);
+
+            /**
+             * Make the calling thread the owner of the pool.
+             **/
+            void BindToCurrentThread() { owner = this_thread::get_id(); }
+
+            /**
+             * Give up a pool allocated with new: it deletes itself once its
+             * last buffer is released, from whichever thread releases it.
+             **/
+            void Abandon();
+
+            /**
+             * Pool used by sessions that are not given one.
+             **/
+            static BufferPool& Default();
+    };
+}
@@ -4,6 +4,11 @@
  * Date: 2021-08-21
  **/
 
+/**
+ * Basic header (3) + message header (11) + extended timestamp (4).
+ **/
+#define MAX_CHUNK_HEADER_SIZE 18
+
 namespace RTMP
 {
 
@@ -117,7 +122,7 @@ namespace RTMP
              * this field MUST be 0xFFFFFF, indicating the presence of the Extended Timestamp field to
              * encode the full 32 bit delta. Otherwise, this field SHOULD be the actual delta.
              **/
-            int timestamp_delta;
+            int timestamp_delta = 0;
 
             /**
              * Size: 3 bytes.
@@ -126,14 +131,14 @@ namespace RTMP
              * generally not the same as the length of the chunk payload. The chunk payload length
              * remainer (which may be the entire length, for a small message) for the last chunk.
              **/
-            int message_length;
+            int message_length = 0;
 
             /**
              * Size: 1 byte.
              * 
              * For a Type 0 or Type 1 chunk, type of the message is sent here.
              **/
-            int message_type_id;
+            int message_type_id = 0;
 
             /**
              * Size: 4 bytes.
@@ -145,7 +150,7 @@ namespace RTMP
              * one message stream is closed and another one subsequently opened, there is no reason an
              * existing chunk stream cannot be reused by sending a new Type 0 chunk.
              **/
-            int message_stream_id;
+            int message_stream_id = 0;
         };
     };
 
@@ -192,7 +197,14 @@ namespace RTMP
          * This field is present in Type 3 chunks when the most recent Type 0, 1 or 2 chunk
          * for the same chunk stream ID indicated the presence of an extended timestamp field.
          **/
-        int extendedTimestamp;
+        int extendedTimestamp = 0;
+        bool hasExtendedTimestamp = false;
+
+        /**
+         * Absolute timestamp of the message, accumulated from the timestamp
+         * deltas of the chunk stream.
+         **/
+        unsigned int timestamp = 0;
 
         /**
          * Chunk Data
@@ -0,0 +1,92 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the chunk stream state table.
+ **/
+
+#include "RTMPChunkStream.hpp"
+
+namespace RTMP
+{
+    ChunkStreamTable::~ChunkStreamTable()
+    {
+        // Release messages left incomplete.
+        for (ChunkStreamState& state : direct)
+            if (state.message != nullptr)
+                state.message->pool->Release(state.message);
+        for (ChunkStreamState& state : slots)
+            if (state.message != nullptr)
+                state.message->pool->Release(state.message);
+    }
+
+    size_t ChunkStreamTable::Slot(unsigned int csid) const
+    {
+        // Fibonacci hashing; the table size is a power of two.
+        return (size_t)((csid * 2654435769u) >> 8) & (slots.size() - 1);
+    }
+
+    void ChunkStreamTable::Grow()
+    {
+        vector<ChunkStreamState> previous;
+        previous.swap(slots);
+        slots.resize(previous.empty() ? 8 : previous.size() * 2);
+
+        for (ChunkStreamState& state : previous)
+        {
+            if (state.csid == 0)
+                continue;
+
+            size_t index = Slot(state.csid);
+            while (slots[index].csid != 0)
+                index = (index + 1) & (slots.size() - 1);
+            slots[index] = state;
+        }
+    }
+
+    ChunkStreamState* ChunkStreamTable::Find(unsigned int csid)
+    {
+        if (csid < 64)
+        {
+            ChunkStreamState& state = direct[csid];
+            return state.csid == csid ? &state : nullptr;
+        }
+
+        if (slots.empty())
+            return nullptr;
+
+        size_t index = Slot(csid);
+        while (slots[index].csid != 0)
+        {
+            if (slots[index].csid == csid)
+                return &slots[index];
+            index = (index + 1) & (slots.size() - 1);
+        }
+        return nullptr;
+    }
+
+    ChunkStreamState& ChunkStreamTable::Get(unsigned int csid)
+    {
+        if (csid < 64)
+        {
+            ChunkStreamState& state = direct[csid];
+            state.csid = csid;
+            return state;
+        }
+
+        if (ChunkStreamState* state = Find(csid))
+            return *state;
+
+        // Keep the load factor under one half.
+        if ((count + 1) * 2 > slots.size())
+            Grow();
+
+        size_t index = Slot(csid);
+        while (slots[index].csid != 0)
+            index = (index + 1) & (slots.size() - 1);
+
+        slots[index].csid = csid;
+        count++;
+        return slots[index];
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Per-session chunk stream state.
+ **/
+
+#include "RTMPChunk.hpp"
+#include "RTMPBufferPool.hpp"
+
+#include <vector>
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * State kept for every chunk stream ID (csid) seen on a session.
+     *
+     * Type 1, 2 and 3 chunks omit the fields that did not change since the
+     * previous chunk of the same chunk stream; they are taken from here.
+     **/
+    struct ChunkStreamState
+    {
+        /**
+         * Chunk stream ID. 0 when the state is unused.
+         **/
+        unsigned int csid = 0;
+
+        /**
+         * Last message header received on this chunk stream, with the fields
+         * omitted by compressed headers already filled in.
+         **/
+        ChunkHeader::MessageHeader header;
+
+        /**
+         * Absolute timestamp of the last message, accumulated from the deltas.
+         **/
+        unsigned int timestamp = 0;
+
+        /**
+         * Whether the last Type 0, 1 or 2 chunk carried an extended timestamp.
+         * Type 3 chunks following it carry one as well.
+         **/
+        bool extendedTimestamp = false;
+
+        /**
+         * Format of the last Type 0, 1 or 2 header sent on this chunk stream.
+         * Only used by the outbound table: after a Type 0 header the timestamp
+         * field holds an absolute timestamp, not a delta a Type 3 could repeat.
+         **/
+        unsigned int format = 0;
+
+        /**
+         * Message being reassembled from several chunks, nullptr between messages.
+         * Its length is the number of payload bytes received so far.
+         **/
+        MessageBuffer* message = nullptr;
+    };
+
+    /**
+     * Chunk stream states, keyed by csid.
+     *
+     * Chunk streams 2-63 (1-byte basic header) are indexed directly. The
+     * 64-65599 range is stored in an open addressing hash table with linear
+     * probing, which stays small since peers rarely use more than a few.
+     **/
+    class ChunkStreamTable
+    {
+        private:
+            ChunkStreamState direct[64];
+
+            vector<ChunkStreamState> slots;
+            size_t count = 0;
+
+            size_t Slot(unsigned int csid) const;
+            void Grow();
+
+        public:
+            ChunkStreamTable() {};
+            ~ChunkStreamTable();
+
+            ChunkStreamTable(const ChunkStreamTable&) = delete;
+            ChunkStreamTable& operator=(const ChunkStreamTable&) = delete;
+
+            /**
+             * State of a chunk stream, or nullptr if nothing was received on it.
+             **/
+            ChunkStreamState* Find(unsigned int csid);
+
+            /**
+             * State of a chunk stream, created if needed. References into the
+             * hashed range are invalidated when another chunk stream is created.
+             **/
+            ChunkStreamState& Get(unsigned int csid);
+    };
+}
@@ -0,0 +1,81 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the per-subscriber egress budget.
+ **/
+
+#include "RTMPEgress.hpp"
+#include "RTMPMessage.hpp"
+
+namespace RTMP
+{
+    bool EgressBudget::Admit(const MediaMessage& message, const OutboundQueue& queue, EgressMetrics& metrics)
+    {
+        // Forget what was written.
+        while (!pending.empty() && pending.front().end <= queue.Written())
+            pending.pop_front();
+
+        size_t backlog = queue.Size();
+        unsigned int duration = 0;
+        if (!pending.empty())
+        {
+            int span = (int)(message.Timestamp() - pending.front().timestamp);
+            if (span > 0)
+                duration = (unsigned int)span;
+        }
+
+        /**
+         * Audio, data and decoder configuration are always worth sending.
+         * Aggregates hold a single media (LiveStream::Aggregate): video ones
+         * hold inter frames and are handled as such, audio ones are audio.
+         **/
+        bool video = message.Type() == Message::Type::VideoMessage
+            || (message.Type() == Message::Type::AggregateMessage && message.Length() > 0
+                && message.Data()[0] == Message::Type::VideoMessage);
+        if (!video || message.IsSequenceHeader())
+            return true;
+
+        bool over = backlog >= maximumBytes || duration >= maximumDuration;
+        bool halfway = backlog >= maximumBytes / 2 || duration >= maximumDuration / 2;
+
+        if (waitKeyframe)
+        {
+            if (message.IsKeyframe() && !over)
+            {
+                waitKeyframe = false;
+                return true;
+            }
+            metrics.droppedVideo++;
+            metrics.droppedBytes += message.Length();
+            return false;
+        }
+
+        if (over)
+        {
+            // Later frames reference this one: skip to the next keyframe.
+            waitKeyframe = true;
+            metrics.droppedVideo++;
+            metrics.droppedBytes += message.Length();
+            return false;
+        }
+
+        if (halfway && message.IsDisposable())
+        {
+            metrics.droppedDisposable++;
+            metrics.droppedBytes += message.Length();
+            return false;
+        }
+        return true;
+    }
+
+    void EgressBudget::Queued(const MediaMessage& message, const OutboundQueue& queue, EgressMetrics& metrics)
+    {
+        Pending entry;
+        entry.end = queue.Queued();
+        entry.timestamp = message.Timestamp();
+        pending.push_back(entry);
+
+        metrics.queuedMessages++;
+    }
+}
@@ -0,0 +1,88 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Per-subscriber egress budget.
+ **/
+
+#include "RTMPMedia.hpp"
+#include "RTMPOutbound.hpp"
+
+#include <cstdint>
+#include <deque>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Media a subscriber was sent or spared. Updated by the session's thread.
+     **/
+    struct EgressMetrics
+    {
+        uint64_t queuedMessages = 0;
+
+        // Non-reference video frames dropped while the backlog is half full.
+        uint64_t droppedDisposable = 0;
+
+        // Video frames dropped while waiting for a keyframe.
+        uint64_t droppedVideo = 0;
+
+        // Messages of any type dropped past the backlog ceiling, closing the subscriber.
+        uint64_t droppedOverflow = 0;
+
+        uint64_t droppedBytes = 0;
+    };
+
+    /**
+     * Admission of live media into a subscriber's outbound queue.
+     *
+     * The backlog is measured in queued bytes and in the timestamp span of
+     * the media not yet written. Past half the budget, non-reference video
+     * frames are dropped; past the budget, video is dropped up to the next
+     * keyframe that fits. Audio, data messages and sequence headers are
+     * always kept: a subscriber whose backlog reaches twice the byte budget
+     * cannot keep up with them either and is let go, so a stalled
+     * subscriber holds bounded memory and never slows the fan-out.
+     **/
+    class EgressBudget
+    {
+        private:
+            struct Pending
+            {
+                // Queue offset the message ends at.
+                uint64_t end;
+                unsigned int timestamp;
+            };
+
+            // Media messages queued and not yet written, oldest first.
+            deque<Pending> pending;
+
+            // Set once a reference frame was dropped, until a keyframe is sent.
+            bool waitKeyframe = false;
+
+        public:
+            size_t maximumBytes = 4 * 1024 * 1024;
+
+            // Milliseconds.
+            unsigned int maximumDuration = 6000;
+
+            /**
+             * Whether `message` may be queued behind what `queue` holds.
+             * Counts the drops in `metrics`. Check Stalled first.
+             **/
+            bool Admit(const MediaMessage& message, const OutboundQueue& queue, EgressMetrics& metrics);
+
+            /**
+             * Whether the backlog of `queue` is past the hard cap, where the
+             * subscriber must be closed rather than spared more messages.
+             **/
+            bool Stalled(const OutboundQueue& queue) const { return queue.Size() >= maximumBytes * 2; }
+
+            /**
+             * Record `message`, just appended to `queue`.
+             **/
+            void Queued(const MediaMessage& message, const OutboundQueue& queue, EgressMetrics& metrics);
+    };
+}
@@ -0,0 +1,121 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Unaligned fixed-width loads and stores.
+ *
+ * RTMP fields are big-endian, except for the message stream ID of
+ * chunk headers which is little-endian. Loads and stores go through
+ * memcpy, which compiles to a single unaligned access, followed by a
+ * byte swap when the host order differs.
+ **/
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#include <stdlib.h>
+#endif
+
+namespace RTMP
+{
+    namespace Endian
+    {
+        #if defined(_WIN32) || (defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+        static constexpr bool LittleEndianHost = true;
+        #else
+        static constexpr bool LittleEndianHost = false;
+        #endif
+
+        inline uint16_t Swap16(uint16_t value)
+        {
+            #if defined(_MSC_VER)
+            return _byteswap_ushort(value);
+            #else
+            return __builtin_bswap16(value);
+            #endif
+        }
+
+        inline uint32_t Swap32(uint32_t value)
+        {
+            #if defined(_MSC_VER)
+            return _byteswap_ulong(value);
+            #else
+            return __builtin_bswap32(value);
+            #endif
+        }
+
+        inline uint64_t Swap64(uint64_t value)
+        {
+            #if defined(_MSC_VER)
+            return _byteswap_uint64(value);
+            #else
+            return __builtin_bswap64(value);
+            #endif
+        }
+
+        inline uint16_t Load16BE(const unsigned char* data)
+        {
+            uint16_t value;
+            memcpy(&value, data, sizeof(value));
+            return LittleEndianHost ? Swap16(value) : value;
+        }
+
+        inline uint32_t Load24BE(const unsigned char* data)
+        {
+            return ((uint32_t)Load16BE(data) << 8) | data[2];
+        }
+
+        inline uint32_t Load32BE(const unsigned char* data)
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return LittleEndianHost ? Swap32(value) : value;
+        }
+
+        inline uint32_t Load32LE(const unsigned char* data)
+        {
+            uint32_t value;
+            memcpy(&value, data, sizeof(value));
+            return LittleEndianHost ? value : Swap32(value);
+        }
+
+        inline uint64_t Load64BE(const unsigned char* data)
+        {
+            uint64_t value;
+            memcpy(&value, data, sizeof(value));
+            return LittleEndianHost ? Swap64(value) : value;
+        }
+
+        inline void Store16BE(unsigned char* data, uint16_t value)
+        {
+            value = LittleEndianHost ? Swap16(value) : value;
+            memcpy(data, &value, sizeof(value));
+        }
+
+        inline void Store24BE(unsigned char* data, uint32_t value)
+        {
+            Store16BE(data, (uint16_t)(value >> 8));
+            data[2] = (unsigned char)value;
+        }
+
+        inline void Store32BE(unsigned char* data, uint32_t value)
+        {
+            value = LittleEndianHost ? Swap32(value) : value;
+            memcpy(data, &value, sizeof(value));
+        }
+
+        inline void Store32LE(unsigned char* data, uint32_t value)
+        {
+            value = LittleEndianHost ? value : Swap32(value);
+            memcpy(data, &value, sizeof(value));
+        }
+
+        inline void Store64BE(unsigned char* data, uint64_t value)
+        {
+            value = LittleEndianHost ? Swap64(value) : value;
+            memcpy(data, &value, sizeof(value));
+        }
+    }
+}
@@ -5,333 +5,929 @@
 
 #include "RTMPHandler.hpp"
 
+#include <cmath>
+
 namespace RTMP
 {
     /**
      * Handle sent data.
      **/
 
-    int Handler::SendData(SOCKET socket, char* data, int length)
+    int Handler::SendData(Session& session, const char* data, int length)
     {
-        // Only supports win32 for now.
-        #ifdef _WIN32
-        Utils::FormatedPrint::PrintFormated(
-            "Handler::SendData", 
-            "Sending " + to_string(length) + " bytes.");
-
-        return send(socket, data, length, 0);
-        #else
-        Utils::FormatedPrint::PrintError(
+        RTMP_TRACE(Debug, Handler,
             "Handler::SendData", 
-            "TCP NOT IMPLEMENTED ON THIS CPU ARCHITECTURE.");
-        #endif
-        return 0;
-    }
-
-    vector<char> ConvertChunkToBytes(Chunk& chunk, char* body, int length)
-    {
-        vector<char> data;
-
-        /**
-         * Basic Header. 
-         */
-        char* basicHeader;
-        int basicHeaderLength = 1;
+            "Sending {} bytes.",
+            length);
 
-        // 2-63
-        if (chunk.basicHeader.csid < 63)
+        if (session.transport == nullptr)
         {
-            basicHeaderLength = 1;
-            basicHeader = new char[basicHeaderLength];
-
-            basicHeader[0] = (chunk.basicHeader.fmt << 6) + (chunk.basicHeader.csid);
+            #ifdef _WIN32
+            return send(session.socket, data, length, 0);
+            #else
+            RTMP_TRACE(Error, Handler,
+                "Handler::SendData", 
+                "Session has no transport.");
+            return -1;
+            #endif
         }
-        // 64-319
-        else if ((319 >= chunk.basicHeader.csid) && (chunk.basicHeader.csid > 63))
-        {
-            basicHeaderLength = 2;
-            basicHeader = new char[basicHeaderLength];
-
-            basicHeader[0] = chunk.basicHeader.fmt << 6;
-            basicHeader[1] = 0;
-            basicHeader[2] = (chunk.basicHeader.csid - 64);
-        }
-        else if ((65559 > chunk.basicHeader.csid) && (chunk.basicHeader.csid > 319))
-        {
-            basicHeaderLength = 3;
-            basicHeader = new char[basicHeaderLength];
 
-            basicHeader[0] = (chunk.basicHeader.fmt << 6) + 1;
-            basicHeader[1] = 0xFF;
-            basicHeader[2] = (chunk.basicHeader.csid - 0xFF) / 256;
-        }
-        else
-            Utils::FormatedPrint::PrintError(
-                "Handler::ConvertChunkToBytes", 
-                "Error, chunk stream id too big. " + to_string(length) + ".");
+        if (session.closing)
+            return -1;
 
-        data.insert(data.end(), basicHeader, basicHeader + basicHeaderLength);
+        // Written with everything else queued during this loop turn.
+        session.outbound.Append(data, length);
+        session.transport->Schedule(session);
+        return length;
+    }
 
-        /**
-         * Message Header. 
-         */
-        switch (chunk.basicHeader.fmt)
-        {
-            case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type0:
-            {
-                char* timestamp = new char[3];
-                char* message_length = new char[3];
-                char* message_type_id = new char[1];
-                char* message_stream_id = new char[4];
-
-                timestamp[0] = (chunk.messageHeader.timestamp_delta >> 16);
-                timestamp[1] = ((chunk.messageHeader.timestamp_delta >> 8) & 0xFF);
-                timestamp[2] = (chunk.messageHeader.timestamp_delta & 0xFF);
- 
-                message_length[0] = (chunk.messageHeader.message_length >> 16);
-                message_length[1] = ((chunk.messageHeader.message_length >> 8) & 0xFF);
-                message_length[2] = (chunk.messageHeader.message_length & 0xFF);
-
-                message_type_id[0] = chunk.messageHeader.message_type_id;
-
-                message_stream_id[3] = (chunk.messageHeader.message_stream_id >> 24);
-                message_stream_id[2] = (chunk.messageHeader.message_stream_id >> 16);
-                message_stream_id[1] = (chunk.messageHeader.message_stream_id >> 8) & 0xFF;
-                message_stream_id[0] = (chunk.messageHeader.message_stream_id & 0xFF);
-
-                data.insert(data.end(), timestamp, timestamp + 3);
-                data.insert(data.end(), message_length, message_length + 3);
-                data.insert(data.end(), message_type_id, message_type_id + 1);
-                data.insert(data.end(), message_stream_id, message_stream_id + 4);
-                break;
-            };
-            case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type1:
-            {
-                char* timestamp_delta = new char[3];
-                char* message_length = new char[3];
-                char* message_type_id = new char[1];
+    int Handler::SendData(Session& session, const char* data, int length, shared_ptr<const void> owner)
+    {
+        if (session.transport == nullptr)
+            return SendData(session, data, length);
 
-                timestamp_delta[0] = chunk.messageHeader.timestamp_delta >> 16;
-                timestamp_delta[1] = (chunk.messageHeader.timestamp_delta >> 8) & 0xFF;
-                timestamp_delta[3] = chunk.messageHeader.timestamp_delta & 0xFF;
+        if (session.closing)
+            return -1;
 
-                message_length[0] = chunk.messageHeader.message_length >> 16;
-                message_length[1] = (chunk.messageHeader.message_length >> 8) & 0xFF;
-                message_length[3] = chunk.messageHeader.message_length & 0xFF;
+        // Referenced in place until written.
+        session.outbound.AppendReference(data, length, move(owner));
+        session.transport->Schedule(session);
+        return length;
+    }
 
-                message_type_id[0] = chunk.messageHeader.message_type_id;
+    /**
+     * AMF0 command message as an AMF3 one: the format byte, then the same
+     * values, objects and arrays switched to AMF3. One encoder for the
+     * message, so that its reference tables span all of them.
+     **/
+    static bool ToAMF3Command(const vector<char>& data, vector<char>& converted)
+    {
+        AMF0Arena arena;
+        const AMF0Value* values = nullptr;
+        size_t count = 0;
+        if (!AMF0Decoder::Decode(reinterpret_cast<const unsigned char*>(data.data()), data.size(), arena, values, count))
+            return false;
 
-                data.insert(data.end(), timestamp_delta, timestamp_delta + 3);
-                data.insert(data.end(), message_length, message_length + 3);
-                data.insert(data.end(), message_type_id, message_type_id + 1);
-                break;
-            };
-            case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type2:
-            {
-                char* timestamp_delta = new char[3];
+        converted.reserve(data.size() + 1);
+        converted.push_back(0x00);
 
-                timestamp_delta[0] = chunk.messageHeader.timestamp_delta >> 16;
-                timestamp_delta[1] = (chunk.messageHeader.timestamp_delta >> 8) & 0xFF;
-                timestamp_delta[3] = chunk.messageHeader.timestamp_delta & 0xFF;
-                
-                data.insert(data.end(), timestamp_delta, timestamp_delta + 3);
-                break;
-            };
-            case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3:
+        AMF3Encoder encoder(converted);
+        for (size_t i = 0; i < count; i++)
+        {
+            switch (values[i].type)
             {
-                // No message header.
-                break;
-            };
+                case AMF0Value::Type::Object:
+                case AMF0Value::Type::TypedObject:
+                case AMF0Value::Type::EcmaArray:
+                case AMF0Value::Type::StrictArray:
+                    converted.push_back(0x11);
+                    encoder.Write(values[i]);
+                    break;
+                default:
+                    AMF0Encoder::Write(converted, values[i]);
+                    break;
+            }
         }
+        return true;
+    }
 
-        data.insert(data.end(), body, body + length);
-
-        chunk.displacement = data.size();
-        return data;
+    /**
+     * Convert an AMF0 command to AMF3 if the peer expects it; returns the
+     * message type to send it as. Commands are answered in the encoding
+     * they came in; what the server sends on its own, in the encoding
+     * negotiated on connect.
+     **/
+    static int EncodeCommand(const Session& session, vector<char>& data, int message_type)
+    {
+        Netconnection::ObjectEncoding encoding = session.pendingCommand != nullptr
+            ? session.pendingCommand->encoding
+            : session.objectEncoding;
+        if (message_type != Message::Type::AMF0CommandMessage || encoding != Netconnection::ObjectEncoding::AMF3)
+            return message_type;
+
+        vector<char> converted;
+        if (!ToAMF3Command(data, converted))
+            return message_type;
+
+        data = move(converted);
+        return Message::Type::AMF3CommandMessage;
     }
 
-    int Handler::SendChunk(char* data, int length, Session& session, int message_type)
+    int Handler::SendChunk(vector<char> data, Session& session, int message_type)
     {
-        Utils::FormatedPrint::PrintFormated(
+        RTMP_TRACE(Debug, Handler,
             "Handler::SendChunk", 
-            "Sending " + to_string(length) + " bytes.");
+            "Sending {} bytes.",
+            data.size());
+
+        message_type = EncodeCommand(session, data, message_type);
 
         Chunk* _chunk = session.lastChunk;
         
         // Chunk to send.
         Chunk chunk;
+        chunk.basicHeader.fmt = ChunkHeader::MessageHeader::ChunkHeaderFormat::Type0;
+        chunk.messageHeader.message_type_id = message_type;
 
-        if (message_type > 0 && message_type <= 6)
+        if ((message_type > 0 && message_type <= 6) || _chunk == nullptr)
         {
             // Message control protocol
-            chunk.basicHeader.fmt = 0;
             chunk.basicHeader.csid = 2;
-            chunk.messageHeader.message_type_id = message_type;
             chunk.messageHeader.message_stream_id = 0;
         }
         else
         {
-            // Other message.
-            chunk.basicHeader.fmt = _chunk->basicHeader.fmt;
+            // Answered on the chunk stream of the request.
             chunk.basicHeader.csid = _chunk->basicHeader.csid;
-            chunk.messageHeader.message_type_id = _chunk->messageHeader.message_type_id;
             chunk.messageHeader.message_stream_id = _chunk->messageHeader.message_stream_id;
         }
 
-
         // Message header.
-        chunk.messageHeader.message_length = length;
-        chunk.messageHeader.timestamp_delta = _chunk->messageHeader.timestamp_delta;
+        chunk.messageHeader.message_length = data.size();
+        chunk.timestamp = 0;
 
-        // Chunk payload.
-        chunk.data = reinterpret_cast<unsigned char*>(data);
+        shared_ptr<vector<char>> payload = make_shared<vector<char>>(move(data));
+        const unsigned char* payloadData = reinterpret_cast<const unsigned char*>(payload->data());
+        size_t payloadLength = payload->size();
 
-        vector<char> chunkData = ConvertChunkToBytes(chunk, data, length);
-        return SendData(session.socket, chunkData.data(), chunk.displacement);
+        return SendMessage(session, chunk, payloadData, payloadLength, move(payload));
     }
 
     /**
-     * Handle received data.
+     * Pick the smallest header format for the first chunk of a message and
+     * fill its timestamp field, given the last header sent on the chunk stream.
+     *
+     * Type 0 when nothing was sent yet, the message stream changes or the
+     * timestamp goes backwards; Type 1 when the length or type changes;
+     * Type 2 when only the timestamp delta changes; Type 3 otherwise.
      **/
+    static void CompressHeader(const ChunkStreamState* state, Chunk& chunk)
+    {
+        typedef ChunkHeader::MessageHeader::ChunkHeaderFormat Format;
+
+        unsigned int delta = state ? chunk.timestamp - state->timestamp : 0;
+
+        if (state == nullptr
+            || state->header.message_stream_id != chunk.messageHeader.message_stream_id
+            || delta > 0x7FFFFFFF)
+        {
+            chunk.basicHeader.fmt = Format::Type0;
+            chunk.messageHeader.timestamp_delta = (int)chunk.timestamp;
+        }
+        else if (state->header.message_length != chunk.messageHeader.message_length
+            || state->header.message_type_id != chunk.messageHeader.message_type_id)
+        {
+            chunk.basicHeader.fmt = Format::Type1;
+            chunk.messageHeader.timestamp_delta = (int)delta;
+        }
+        else if (state->format == Format::Type0
+            || (unsigned int)state->header.timestamp_delta != delta)
+        {
+            chunk.basicHeader.fmt = Format::Type2;
+            chunk.messageHeader.timestamp_delta = (int)delta;
+        }
+        else
+        {
+            // Same delta as the previous message: the header is implied.
+            chunk.basicHeader.fmt = Format::Type3;
+            chunk.messageHeader.timestamp_delta = (int)delta;
+            chunk.hasExtendedTimestamp = state->extendedTimestamp;
+            chunk.extendedTimestamp = (int)delta;
+        }
+    }
 
-    int Handler::HandleCommandMessage(Netconnection::Command* command, Session& session)
+    /**
+     * Encode the first chunk header of `message` into `header` and record it
+     * in the session's outbound chunk stream state. On return, `chunk` holds
+     * the extended timestamp the continuation headers must repeat.
+     * Returns the header length, or 0 if the chunk stream ID is out of range.
+     **/
+    static size_t EncodeFirstHeader(Session& session, const Chunk& message, Chunk& chunk, unsigned char* header)
     {
-        int status = 0;
-        if (command == nullptr) return -1;
+        chunk.basicHeader.csid = message.basicHeader.csid;
+        chunk.messageHeader = message.messageHeader;
+        chunk.timestamp = message.timestamp;
+        CompressHeader(session.outChunkStreams.Find(chunk.basicHeader.csid), chunk);
 
-        if (Netconnection::Connect* cmd = dynamic_cast<Netconnection::Connect*>(command))
+        size_t headerLength = Serializer::EncodeChunkHeader(chunk, header);
+        if (headerLength == 0)
         {
+            RTMP_TRACE(Error, Handler,
+                "Handler::SendMessage", 
+                "Chunk stream id out of range: {}.",
+                chunk.basicHeader.csid);
+            return 0;
+        }
 
-            Utils::FormatedPrint::PrintFormated(
-                "Handler::HandleCommandMessage", 
-                "Connect command response.");          
+        // The receiver applies the same header to its chunk stream state.
+        ChunkStreamState& state = session.outChunkStreams.Get(chunk.basicHeader.csid);
+        if (chunk.basicHeader.fmt != ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3)
+        {
+            state.format = chunk.basicHeader.fmt;
+            state.extendedTimestamp = (unsigned int)chunk.messageHeader.timestamp_delta >= 0xFFFFFF;
+        }
+        state.header = chunk.messageHeader;
+        state.timestamp = chunk.timestamp;
 
-            session.pendingCommand = cmd;
+        chunk.hasExtendedTimestamp = state.extendedTimestamp;
+        chunk.extendedTimestamp = chunk.messageHeader.timestamp_delta;
+        return headerLength;
+    }
 
-            status += InitializeConnect(session);
+    int Handler::SendMessage(Session& session, const Chunk& message, const unsigned char* payload, size_t length, shared_ptr<const void> owner)
+    {
+        Chunk chunk;
+        unsigned char header[MAX_CHUNK_HEADER_SIZE];
+        size_t headerLength = EncodeFirstHeader(session, message, chunk, header);
+        if (headerLength == 0)
+            return -1;
 
-            Utils::FormatedPrint::PrintInfo("Initialize done.");
+        size_t chunkSize = session.outChunkSize;
+        size_t first = length < chunkSize ? length : chunkSize;
 
-                        
-        }
-        else if (Netconnection::ConnectResponse* cmd = dynamic_cast<Netconnection::ConnectResponse*>(command))
+        // Headers are copied, the payload is referenced.
+        int status = SendData(session, reinterpret_cast<const char*>(header), (int)headerLength);
+        if (status < 0)
+            return status;
+        status += SendData(session, reinterpret_cast<const char*>(payload), (int)first, owner);
+
+        if (first == length)
+            return status;
+
+        /**
+         * Continuations: Type 3 headers, repeating the extended timestamp
+         * when the first header carried one. The same bytes serve every chunk.
+         **/
+        Chunk continuation;
+        continuation.basicHeader.fmt = ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3;
+        continuation.basicHeader.csid = chunk.basicHeader.csid;
+        continuation.hasExtendedTimestamp = chunk.hasExtendedTimestamp;
+        continuation.extendedTimestamp = chunk.extendedTimestamp;
+        headerLength = Serializer::EncodeChunkHeader(continuation, header);
+
+        for (size_t offset = first; offset < length; offset += chunkSize)
         {
+            size_t slice = length - offset < chunkSize ? length - offset : chunkSize;
+            status += SendData(session, reinterpret_cast<const char*>(header), (int)headerLength);
+            status += SendData(session, reinterpret_cast<const char*>(payload + offset), (int)slice, owner);
+        }
+        return status;
+    }
 
+    int Handler::SendMedia(Session& session, const shared_ptr<const MediaMessage>& message)
+    {
+        if (session.closing)
+            return -1;
+
+        // Too far behind to keep even the audio: let it go.
+        if (session.egress.Stalled(session.outbound))
+        {
+            RTMP_TRACE(Warning, Handler,
+                "Handler::SendMedia",
+                "Subscriber backlog of {} bytes past the limit, closing session.",
+                session.outbound.Size());
+
+            session.metrics.droppedOverflow++;
+            session.metrics.droppedBytes += message->Length();
+            session.closing = true;
+            session.transport->Schedule(session);
+            return -1;
         }
-        else if (Netconnection::Call* cmd = dynamic_cast<Netconnection::Call*>(command))
+
+        // Slow subscribers are spared frames rather than buffered without bound.
+        if (!session.egress.Admit(*message, session.outbound, session.metrics))
+            return 0;
+
+        Chunk media;
+        media.basicHeader.csid = MediaMessage::ChunkStream(message->Type());
+        media.messageHeader.message_type_id = message->Type();
+        media.messageHeader.message_length = (int)message->Length();
+        media.messageHeader.message_stream_id = session.streamID;
+        media.timestamp = message->Timestamp();
+
+        Chunk chunk;
+        unsigned char header[MAX_CHUNK_HEADER_SIZE];
+        size_t headerLength = EncodeFirstHeader(session, media, chunk, header);
+        if (headerLength == 0)
+            return -1;
+
+        // Everything after the first header is shared with the other subscribers.
+        Slice body = message->Serialized(session.outChunkSize, chunk.basicHeader.csid,
+            chunk.hasExtendedTimestamp, (unsigned int)chunk.extendedTimestamp, *session.bufferPool);
+
+        int status = SendData(session, reinterpret_cast<const char*>(header), (int)headerLength);
+        if (status < 0)
+            return status;
+        status += SendData(session, reinterpret_cast<const char*>(body.data), (int)body.length, message);
+
+        session.egress.Queued(*message, session.outbound, session.metrics);
+        return status;
+    }
+
+    /**
+     * Command on the session's message stream, sent outside of a request.
+     **/
+    static int SendStreamCommand(Session& session, vector<char> data)
+    {
+        Chunk command;
+        command.basicHeader.csid = 5;
+        command.messageHeader.message_type_id = EncodeCommand(session, data, Message::Type::AMF0CommandMessage);
+        command.messageHeader.message_length = (int)data.size();
+        command.messageHeader.message_stream_id = session.streamID;
+        command.timestamp = 0;
+
+        shared_ptr<vector<char>> payload = make_shared<vector<char>>(move(data));
+        const unsigned char* payloadData = reinterpret_cast<const unsigned char*>(payload->data());
+        size_t payloadLength = payload->size();
+
+        return Handler::SendMessage(session, command, payloadData, payloadLength, move(payload));
+    }
+
+    /**
+     * Send an FLV tag of the file the session plays, referenced in the mapping.
+     **/
+    static int SendTag(Session& session, const VodTag& tag, unsigned int timestamp)
+    {
+        Chunk media;
+        media.basicHeader.csid = MediaMessage::ChunkStream(tag.type);
+        media.messageHeader.message_type_id = tag.type;
+        media.messageHeader.message_length = (int)tag.length;
+        media.messageHeader.message_stream_id = session.streamID;
+        media.timestamp = timestamp;
+
+        return Handler::SendMessage(session, media, tag.data, tag.length, session.vod.file);
+    }
+
+    /**
+     * Queue tags until a window is queued, or the end of the file.
+     **/
+    static int PumpPlayback(Session& session)
+    {
+        VodPlayback& vod = session.vod;
+        if (vod.file == nullptr || vod.ended)
+            return 0;
+
+        int status = 0;
+        VodTag tag;
+        while (session.outbound.Size() < VodPlayback::Window)
         {
-            
+            if (!vod.file->ReadTag(vod.position, tag))
+            {
+                vod.ended = true;
+                status += Handler::SendChunk(ServerResponse::StreamEOF(session), session, 0x04);
+                status += SendStreamCommand(session, ServerResponse::OnStatus(session, 0, "NetStream.Play.Stop", "End of the file."));
+                break;
+            }
+
+            vod.position = tag.next;
+            if (tag.type == Message::Type::AudioMessage || tag.type == Message::Type::VideoMessage
+                || tag.type == Message::Type::AMF0DataMessage)
+                status += SendTag(session, tag, tag.timestamp);
         }
-        else if (Netconnection::CallResponse* cmd = dynamic_cast<Netconnection::CallResponse*>(command))
+        return status;
+    }
+
+    /**
+     * Play the session's file from `position`, a keyframe or the first tag.
+     **/
+    static int StartPlayback(Session& session, uint64_t position)
+    {
+        VodPlayback& vod = session.vod;
+        const VodFile& file = *vod.file;
+        int status = 0;
+
+        /**
+         * Past the start of the file, the metadata and decoder configuration
+         * are sent again first, at the keyframe's time.
+         **/
+        VodTag start;
+        if (position != file.FirstTag() && file.ReadTag(position, start))
         {
-            
+            uint64_t priming[3] = { file.Metadata(), file.VideoHeader(), file.AudioHeader() };
+            for (uint64_t tagPosition : priming)
+            {
+                VodTag tag;
+                if (tagPosition != 0 && file.ReadTag(tagPosition, tag))
+                    status += SendTag(session, tag, start.timestamp);
+            }
         }
-        else if (Netconnection::CreateStream* cmd = dynamic_cast<Netconnection::CreateStream*>(command))
+
+        vod.position = position;
+        vod.ended = false;
+        return status + PumpPlayback(session);
+    }
+
+    void Handler::HandleDrained(Session& session)
+    {
+        if (session.vod.file != nullptr && PumpPlayback(session) < 0)
+            session.closing = true;
+    }
+
+    void Handler::HandleUnpublished(Session& session)
+    {
+        session.playing.reset();
+
+        if (SendChunk(ServerResponse::StreamEOF(session), session, 0x04) < 0
+            || SendStreamCommand(session, ServerResponse::OnStatus(session, 0, "NetStream.Play.UnpublishNotify", "The stream was unpublished.")) < 0)
         {
-            vector<char> data;
-            Utils::FormatedPrint::PrintFormated(
-                "Handler::HandleCommandMessage", 
-                "Handling response for create stream command message."
-            );
+            // Not handling an event of the session: its transport closes it with the scheduled ones.
+            session.closing = true;
+            if (session.transport != nullptr)
+                session.transport->Schedule(session);
+        }
+    }
 
-            /**
-             * @brief 
-             * createStream response -> _result
-             * 
-             */
+    /**
+     * Remove the stream the session publishes and detach its subscribers.
+     **/
+    static void StopPublishing(Session& session)
+    {
+        StreamRegistry::Default().Unpublish(*session.publishing);
+        session.publishing->End(session.transport);
+        session.publishing.reset();
+    }
 
-            data = RTMP::ServerResponse::CreateStreamResponse(session);
-            status += SendChunk(data.data(), data.size(), session, 0x14);
-            
-            
+    void Handler::CloseSession(Session& session)
+    {
+        if (session.playing)
+        {
+            session.playing->Unsubscribe(session);
+            session.playing.reset();
         }
-        else if (Netconnection::CreateStreamResponse* cmd = dynamic_cast<Netconnection::CreateStreamResponse*>(command))
+        if (session.publishing)
+            StopPublishing(session);
+        if (session.recording)
         {
-            
+            session.recording->Close();
+            session.recording.reset();
         }
-        else if (Netconnection::OnStatus* cmd = dynamic_cast<Netconnection::OnStatus*>(command))
+        session.vod = VodPlayback();
+    }
+
+    /**
+     * Command handlers.
+     **/
+
+    typedef int (*CommandHandler)(const AMF0Command& command, Session& session);
+
+    static int UnknownCommand(const AMF0Command&, Session&)
+    {
+        RTMP_TRACE(Error, Handler,
+            "Handler::HandleCommandMessage", 
+            "Unknown command type.");
+        return 0;
+    }
+
+    // Commands the server does not act on.
+    static int IgnoreCommand(const AMF0Command&, Session&)
+    {
+        return 0;
+    }
+
+    /**
+     * Number argument sent by the client, clamped to [minimum, maximum];
+     * `fallback` when missing, not a number or infinite.
+     **/
+    static double NumberArgument(const AMF0Value& argument, double minimum, double maximum, double fallback)
+    {
+        if (!argument.IsNumber() || !isfinite(argument.number))
+            return fallback;
+        if (argument.number < minimum)
+            return minimum;
+        if (argument.number > maximum)
+            return maximum;
+        return argument.number;
+    }
+
+    static int HandleConnect(const AMF0Command& command, Session& session)
+    {
+        int status = 0;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "Connect command response.");
+
+        // AMF3 if the client asks for it, in the command object; the result says which.
+        const AMF0Value* objectEncoding = command.Argument(0).Find("objectEncoding");
+        session.objectEncoding = objectEncoding != nullptr && objectEncoding->IsNumber() && objectEncoding->number == (double)Netconnection::ObjectEncoding::AMF3
+            ? Netconnection::ObjectEncoding::AMF3
+            : Netconnection::ObjectEncoding::AMF0;
+
+        status += Handler::InitializeConnect(session);
+
+        RTMP_TRACE(Info, Handler,
+            "Handler::HandleCommandMessage",
+            "Initialize done.");
+        return status;
+    }
+
+    static int HandleCreateStream(const AMF0Command&, Session& session)
+    {
+        int status = 0;
+        vector<char> data;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "Handling response for create stream command message."
+        );
+
+        /**
+         * @brief
+         * createStream response -> _result
+         *
+         */
+
+        data = RTMP::ServerResponse::CreateStreamResponse(session);
+        status += Handler::SendChunk(move(data), session, 0x14);
+        return status;
+    }
+
+    /**
+     * Answer a play of the recorded stream, once its file is open; nullptr
+     * if there is none. `start` in seconds, -2 from the start.
+     **/
+    static int PlayFile(Session& session, shared_ptr<VodFile> file, int start)
+    {
+        int status = 0;
+
+        vector<char> data;
+        if (file == nullptr)
         {
-            
+            data = RTMP::ServerResponse::OnStatus(session, 2, "NetStream.Play.StreamNotFound", "No stream is published under this name.");
+            status += Handler::SendChunk(move(data), session, 0x14);
+            return status;
         }
-        else if (Netconnection::Play* cmd = dynamic_cast<Netconnection::Play*>(command))
+
+        if (session.playing)
         {
-            
+            session.playing->Unsubscribe(session);
+            session.playing.reset();
         }
-        else if (Netconnection::Play2* cmd = dynamic_cast<Netconnection::Play2*>(command))
+        session.vod = VodPlayback();
+
+        data = RTMP::ServerResponse::StreamBegin(session);
+        status += Handler::SendChunk(move(data), session, 0x04);
+
+        data = RTMP::ServerResponse::StreamIsRecorded(session);
+        status += Handler::SendChunk(move(data), session, 0x04);
+
+        data = RTMP::ServerResponse::OnStatus(session, 0, "NetStream.Play.Start", "Starting the stream.");
+        status += Handler::SendChunk(move(data), session, 0x14);
+
+        session.vod.file = file;
+        status += StartPlayback(session, start > 0 ? file->Seek((unsigned int)((uint64_t)start * 1000)) : file->FirstTag());
+        return status;
+    }
+
+    static int HandlePlay(const AMF0Command& command, Session& session)
+    {
+        int status = 0;
+
+        // Command object, stream name, start, duration, reset.
+        string streamName(command.Argument(1).string);
+        // In seconds; past the largest position a file can have, its end.
+        const double MaximumStart = (double)(0xFFFFFFFFu / 1000);
+        int start = (int)NumberArgument(command.Argument(2), -2, MaximumStart, -2);
+
+        vector<char> data;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "Play command message.");
+
+        // A file still being opened for an earlier play is not played.
+        session.vod.opening.reset();
+
+        /**
+         * Start: -2 plays the live stream, else the recorded one;
+         * -1 only the live stream; 0 and more the recorded one from
+         * that many seconds.
+         **/
+        shared_ptr<LiveStream> stream;
+        if (start < 0)
+            stream = StreamRegistry::Default().Find(streamName);
+
+        if (stream == nullptr && start != -1)
         {
-            
+            /**
+             * Answered once the file is open, which may wait for it to be
+             * indexed off this thread. The session may be closed meanwhile,
+             * resetting what `opening` points to.
+             **/
+            shared_ptr<const string> opening = make_shared<const string>(streamName);
+            session.vod.opening = opening;
+
+            Session* target = &session;
+            weak_ptr<const string> pending = opening;
+            VodLibrary::Default().Open(streamName, *session.transport, [target, pending, start](shared_ptr<VodFile> file) {
+                if (pending.expired())
+                    return;
+                target->vod.opening.reset();
+
+                // Not handling an event of the session when posted: its transport closes it with the scheduled ones.
+                if (PlayFile(*target, move(file), start) < 0)
+                {
+                    target->closing = true;
+                    target->transport->Schedule(*target);
+                }
+            });
+            return status;
         }
-        else if (Netconnection::DeleteStream* cmd = dynamic_cast<Netconnection::DeleteStream*>(command))
+
+        if (stream == nullptr)
         {
-            
+            data = RTMP::ServerResponse::OnStatus(session, 2, "NetStream.Play.StreamNotFound", "No stream is published under this name.");
+            status += Handler::SendChunk(move(data), session, 0x14);
+            return status;
         }
-        else if (Netconnection::ReceiveAudio* cmd = dynamic_cast<Netconnection::ReceiveAudio*>(command))
+
+        if (session.playing)
         {
-            
+            session.playing->Unsubscribe(session);
+            session.playing.reset();
         }
-        else if (Netconnection::ReceiveVideo* cmd = dynamic_cast<Netconnection::ReceiveVideo*>(command))
+        session.vod = VodPlayback();
+
+        data = RTMP::ServerResponse::StreamBegin(session);
+        status += Handler::SendChunk(move(data), session, 0x04);
+
+        data = RTMP::ServerResponse::OnStatus(session, 0, "NetStream.Play.Start", "Starting the stream.");
+        status += Handler::SendChunk(move(data), session, 0x14);
+
+        session.playing = stream;
+        stream->Subscribe(session);
+        return status;
+    }
+
+    static int HandlePublish(const AMF0Command& command, Session& session)
+    {
+        int status = 0;
+
+        // Command object, publishing name, publishing type.
+        string publishingName(command.Argument(1).string);
+        string_view publishingType = command.Argument(2).string;
+
+        vector<char> data;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "Publish command message."
+        );
+        // Messages received from now on are sent to the stream's subscribers.
+        shared_ptr<LiveStream> stream = StreamRegistry::Default().Publish(publishingName);
+        if (stream == nullptr)
         {
-            
+            data = RTMP::ServerResponse::OnStatus(session, 2, "NetStream.Publish.BadName", "The stream is already published.");
+            status += Handler::SendChunk(move(data), session, 0x14);
         }
-        else if (Netconnection::Publish* cmd = dynamic_cast<Netconnection::Publish*>(command))
+        else
         {
-            vector<char> data;
-            Utils::FormatedPrint::PrintFormated(
-                "Handler::HandleCommandMessage",
-                "Publish command message."
-            );
+            if (session.publishing)
+                StopPublishing(session);
+            session.publishing = stream;
+
+            if (session.recording)
+            {
+                session.recording->Close();
+                session.recording.reset();
+            }
+            if (publishingType == "record" || publishingType == "append")
+                session.recording = Recorder::Default().Open(publishingName, publishingType == "append");
+
             data = RTMP::ServerResponse::StreamBegin(session);
-            status += SendChunk(data.data(), data.size(), session, 0x04);
+            status += Handler::SendChunk(move(data), session, 0x04);
 
             data = RTMP::ServerResponse::OnStatus(session, 0, "NetStream.Publish.Start", "Starting the stream.");
-            status += SendChunk(data.data(), data.size(), session, 0x14);
-        }
-        else if (Netconnection::Seek* cmd = dynamic_cast<Netconnection::Seek*>(command))
-        {
-            
-        }
-        else if (Netconnection::Pause* cmd = dynamic_cast<Netconnection::Pause*>(command))
-        {
-            
+            status += Handler::SendChunk(move(data), session, 0x14);
         }
-        else if (Netconnection::ReleaseStream* cmd = dynamic_cast<Netconnection::ReleaseStream*>(command))
+        return status;
+    }
+
+    static int HandleSeek(const AMF0Command& command, Session& session)
+    {
+        int status = 0;
+
+        // Command object, milliseconds.
+        unsigned int requested = (unsigned int)NumberArgument(command.Argument(1), 0, (double)0xFFFFFFFFu, 0);
+
+        vector<char> data;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "Seek command message, {} ms.",
+            requested);
+
+        // Live streams cannot be seeked.
+        if (session.vod.file == nullptr)
         {
-            Utils::FormatedPrint::PrintFormated(
-                "Handler::HandleCommandMessage",
-                "Release Stream command message."
-            );
+            data = RTMP::ServerResponse::OnStatus(session, 2, "NetStream.Seek.Failed", "The stream is not recorded.");
+            status += Handler::SendChunk(move(data), session, 0x14);
         }
-        else if (Netconnection::FCPublish* cmd = dynamic_cast<Netconnection::FCPublish*>(command))
+        else
         {
-            vector<char> data;
-            Utils::FormatedPrint::PrintFormated(
-                "Handler::HandleCommandMessage",
-                "FCPublish command message."
-            );
-            /**
-             * @brief 
-             * publish response -> _result
-             * 
-             */
+            data = RTMP::ServerResponse::OnStatus(session, 0, "NetStream.Seek.Notify", "Seeking.");
+            status += Handler::SendChunk(move(data), session, 0x14);
 
+            // What is already queued is sent first; it cannot be taken back mid-chunk.
+            status += StartPlayback(session, session.vod.file->Seek(requested));
         }
-        else 
+        return status;
+    }
+
+    static int HandleReleaseStream(const AMF0Command&, Session&)
+    {
+        int status = 0;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "Release Stream command message."
+        );
+        return status;
+    }
+
+    static int HandleFCPublish(const AMF0Command&, Session&)
+    {
+        int status = 0;
+        RTMP_TRACE(Debug, Handler,
+            "Handler::HandleCommandMessage",
+            "FCPublish command message."
+        );
+        /**
+         * @brief
+         * publish response -> _result
+         *
+         */
+        return status;
+    }
+
+    /**
+     * Indexed by Netconnection::CommandType.
+     **/
+    static const CommandHandler CommandHandlers[] = {
+        UnknownCommand,      // Null
+        HandleConnect,       // Connect
+        IgnoreCommand,       // ConnectResponse
+        IgnoreCommand,       // Call
+        IgnoreCommand,       // CallResponse
+        HandleCreateStream,  // CreateStream
+        IgnoreCommand,       // CreateStreamResponse
+        IgnoreCommand,       // OnStatus
+        HandlePlay,          // Play
+        IgnoreCommand,       // Play2
+        IgnoreCommand,       // DeleteStream
+        IgnoreCommand,       // ReceiveAudio
+        IgnoreCommand,       // ReceiveVideo
+        HandlePublish,       // Publish
+        HandleSeek,          // Seek
+        IgnoreCommand,       // Pause
+        HandleReleaseStream, // ReleaseStream
+        HandleFCPublish      // FCPublish
+    };
+
+    static_assert(sizeof(CommandHandlers) / sizeof(CommandHandlers[0]) == (size_t)Netconnection::CommandType::FCPublish + 1,
+        "One handler per command type.");
+
+    /**
+     * Handle received data.
+     **/
+
+    int Handler::HandleCommandMessage(const AMF0Command& command, Session& session)
+    {
+        // One lookup, whatever the command.
+        size_t index = (size_t)command.type;
+        if (index >= sizeof(CommandHandlers) / sizeof(CommandHandlers[0]))
+            return UnknownCommand(command, session);
+        return CommandHandlers[index](command, session);
+    }
+
+    void Handler::HandleVideoMessage(Chunk& chunk, Session& session)
+    {
+        if (session.publishing == nullptr)
+            return;
+
+        // Copied once out of the receive buffers, then shared by every subscriber.
+        shared_ptr<const MediaMessage> message = make_shared<MediaMessage>(*session.bufferPool,
+            chunk.messageHeader.message_type_id, chunk.timestamp, chunk.data, chunk.messageHeader.message_length);
+        if (session.recording)
+            session.recording->Write(*message);
+        session.publishing->Publish(move(message), session.transport);
+    }
+
+    void Handler::HandleAudioMessage(Chunk& chunk, Session& session)
+    {
+        if (session.publishing == nullptr)
+            return;
+
+        shared_ptr<const MediaMessage> message = make_shared<MediaMessage>(*session.bufferPool,
+            chunk.messageHeader.message_type_id, chunk.timestamp, chunk.data, chunk.messageHeader.message_length);
+        if (session.recording)
+            session.recording->Write(*message);
+        session.publishing->Publish(move(message), session.transport);
+    }
+
+    void Handler::HandleDataMessage(Chunk& chunk, Session& session)
+    {
+        if (session.publishing == nullptr)
+            return;
+
+        const unsigned char* data = chunk.data;
+        size_t length = chunk.messageHeader.message_length;
+
+        /**
+         * Publishers wrap the metadata in @setDataFrame, which tells the
+         * server to keep it; subscribers are sent what follows.
+         **/
+        static const unsigned char SetDataFrame[] = { 0x02, 0x00, 0x0D, '@', 's', 'e', 't', 'D', 'a', 't', 'a', 'F', 'r', 'a', 'm', 'e' };
+        if (length >= sizeof(SetDataFrame) && memcmp(data, SetDataFrame, sizeof(SetDataFrame)) == 0)
         {
-            Utils::FormatedPrint::PrintError(
-                "Handler::HandleCommandMessage", 
-                "Unknown command type.");
+            data += sizeof(SetDataFrame);
+            length -= sizeof(SetDataFrame);
         }
-        return status;
+
+        shared_ptr<const MediaMessage> message = make_shared<MediaMessage>(*session.bufferPool,
+            chunk.messageHeader.message_type_id, chunk.timestamp, data, length);
+        if (session.recording)
+            session.recording->Write(*message);
+        session.publishing->Publish(move(message), session.transport);
     }
 
-    void Handler::HandleVideoMessage(unsigned char* data, Session& session)
+    void Handler::HandleAMF3DataMessage(Chunk& chunk, Session& session)
     {
+        if (session.publishing == nullptr || chunk.messageHeader.message_length < 1)
+            return;
+
+        /**
+         * Passed on as AMF0, with the references resolved: every player
+         * reads it, and so does FLV, where it is recorded.
+         **/
+        const AMF0Value* values = nullptr;
+        size_t count = 0;
+        bool decoded = AMF0Decoder::Decode(chunk.data + 1, chunk.messageHeader.message_length - 1, session.commandArena, values, count);
+
+        vector<char> converted;
+        for (size_t i = 0; decoded && i < count; i++)
+            AMF0Encoder::Write(converted, values[i]);
+        session.commandArena.Reset();
 
+        if (!decoded)
+        {
+            RTMP_TRACE(Warning, Handler,
+                "Handler::HandleAMF3DataMessage",
+                "Malformed AMF3 data message.");
+            return;
+        }
+
+        Chunk message = chunk;
+        message.messageHeader.message_type_id = Message::Type::AMF0DataMessage;
+        message.messageHeader.message_length = (int)converted.size();
+        message.data = reinterpret_cast<unsigned char*>(converted.data());
+        HandleDataMessage(message, session);
     }
 
-    void Handler::HandleAudioMessage(unsigned char* data, Session& session)
+    int Handler::HandleAggregateMessage(Chunk& chunk, Session& session)
     {
+        int status = 0;
+        const unsigned char* data = chunk.data;
+        size_t length = chunk.messageHeader.message_length;
+
+        /**
+         * FLV tags: 11-byte header, data, 4-byte back pointer. Each one is
+         * handled as a message of its own, pointing into the aggregate.
+         * Timestamps are rebased on the aggregate's: the first tag carries
+         * the aggregate timestamp, the next ones their offset from it.
+         **/
+        size_t offset = 0;
+        bool first = true;
+        unsigned int base = 0;
+        while (offset + 11 <= length)
+        {
+            const unsigned char* tag = data + offset;
+            int type = tag[0];
+            size_t size = Endian::Load24BE(tag + 1);
+            unsigned int timestamp = Endian::Load24BE(tag + 4) | ((unsigned int)tag[7] << 24);
+
+            if (size > length - offset - 11)
+            {
+                RTMP_TRACE(Warning, Handler,
+                    "Handler::HandleAggregateMessage",
+                    "Truncated aggregate message.");
+                return -1;
+            }
+
+            if (first)
+            {
+                base = timestamp;
+                first = false;
+            }
+
+            Chunk message = chunk;
+            message.messageHeader.message_type_id = type;
+            message.messageHeader.message_length = (int)size;
+            message.timestamp = chunk.timestamp + (timestamp - base);
+            message.data = const_cast<unsigned char*>(tag + 11);
+
+            // Media and data only; an aggregate never nests another.
+            if (type == Message::Type::AudioMessage || type == Message::Type::VideoMessage
+                || type == Message::Type::AMF0DataMessage)
+                status += HandleChunk(message, session);
 
+            offset += 11 + size + 4;
+        }
+        return status;
     }
 
     int Handler::InitializeConnect(Session& session)
@@ -351,33 +947,64 @@ namespace RTMP
          * Window acknowledge size
          */
         vector<char> windowAckData = ProtocolControlMessage::vSetWindowAcknowledgementSize(4096);
-        status += SendChunk(windowAckData.data(), windowAckData.size(), session, (int)ProtocolControlMessage::Type::WindowAcknowledgementSize);
+        status += SendChunk(move(windowAckData), session, (int)ProtocolControlMessage::Type::WindowAcknowledgementSize);
 
         /**
          * Set Peer Bandwith
          */
         vector<char> setPeerBandwidthData = ProtocolControlMessage::vSetPeerBandwidth(4096, ProtocolControlMessage::PeerBandwithLimitType::Hard);
-        status += SendChunk(setPeerBandwidthData.data(), setPeerBandwidthData.size(), session, (int)ProtocolControlMessage::Type::SetPeerBandwidth);
+        status += SendChunk(move(setPeerBandwidthData), session, (int)ProtocolControlMessage::Type::SetPeerBandwidth);
 
         /**
          * Set Chunk Size
+         * Applies to the messages sent after this one.
          */
-        vector<char> setChunkSizeData = ProtocolControlMessage::vSetChunkSize(4096);
-        status += SendChunk(setChunkSizeData.data(), setChunkSizeData.size(), session, (int)ProtocolControlMessage::Type::SetChunkSize);
+        const unsigned int chunkSize = 4096;
+        vector<char> setChunkSizeData = ProtocolControlMessage::vSetChunkSize(chunkSize);
+        status += SendChunk(move(setChunkSizeData), session, (int)ProtocolControlMessage::Type::SetChunkSize);
+        session.outChunkSize = chunkSize;
 
         /**
          * Connect Response (_result)
          */
         vector<char> connectResponseData = ServerResponse::ConnectResponse(session);
-        status += SendChunk(connectResponseData.data(), connectResponseData.size(), session, 0x14);
+        status += SendChunk(move(connectResponseData), session, 0x14);
 
         return status;
         
     }
 
+    /**
+     * Decode a command message and dispatch it.
+     **/
+    static int DispatchCommand(const unsigned char* data, size_t length, Netconnection::ObjectEncoding encoding, Session& session)
+    {
+        int status = 0;
+
+        // Strings are views into the message, the rest is in the arena.
+        AMF0Command command;
+        if (!AMF0Decoder::DecodeCommand(data, length, session.commandArena, command))
+        {
+            RTMP_TRACE(Error, Handler,
+                "Handler::HandleChunk",
+                "Malformed command message.");
+            session.commandArena.Reset();
+            return 0;
+        }
+        command.encoding = encoding;
+
+        session.pendingCommand = &command;
+        status += Handler::HandleCommandMessage(command, session);
+        session.pendingCommand = nullptr;
+
+        // Everything decoded is released in one step.
+        session.commandArena.Reset();
+        return status;
+    }
+
     int Handler::HandleChunk(Chunk& chunk, Session& session)
     {
-        Utils::FormatedPrint::PrintBytes<unsigned char>(chunk.data, chunk.messageHeader.message_length);
+        RTMP_TRACE_BYTES(Handler, chunk.data, chunk.messageHeader.message_length);
         int status = 0;
         /** 
          * Determine message type.
@@ -385,13 +1012,13 @@ namespace RTMP
         if (chunk.messageHeader.message_type_id == 0)
         {
             // Idk if this is possible.
-            Utils::FormatedPrint::PrintFormated(
+            RTMP_TRACE(Debug, Handler,
                 "Handler::HandleChunk", 
                 "Message type ID of 0.");
         }
         else if (chunk.messageHeader.message_type_id == 4)
         {
-            Utils::FormatedPrint::PrintFormated(
+            RTMP_TRACE(Debug, Handler,
                 "Handler::HandleChunk", 
                 "User control message.");
         }
@@ -402,19 +1029,28 @@ namespace RTMP
             {
                 case ProtocolControlMessage::Type::SetChunkSize:
                 {
-                    int chunksize = 0;
-                    for (int i = 0; i < 16; i++)
-                        printf("\n%i", chunk.data[i]);
+                    if (chunk.messageHeader.message_length < 4)
+                        return -1;
+
+                    unsigned int chunksize = 0;
                     Utils::BitOperations::bytesToInteger(
                         chunksize, 
-                        session.lastChunk->data, 
+                        chunk.data, 
                         false, 
-                        chunk.messageHeader.message_length);
-                    Utils::FormatedPrint::PrintFormated(
+                        4);
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
-                        "Protocol control message: Set chunk size -> " + to_string(chunksize) + ".");
+                        "Protocol control message: Set chunk size -> {}.",
+                        chunksize);
 
-                    session.Bandwidth = chunksize;
+                    // The first bit must be zero; chunks never exceed the largest message.
+                    chunksize &= 0x7FFFFFFF;
+                    if (chunksize == 0)
+                        return -1;
+                    if (chunksize > 0xFFFFFF)
+                        chunksize = 0xFFFFFF;
+
+                    session.inChunkSize = chunksize;
                     break;
                 };
                 case ProtocolControlMessage::Type::Abort:
@@ -426,11 +1062,21 @@ namespace RTMP
                         false,
                         chunk.messageHeader.message_length
                     );
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
-                        "Protocol control message: Abort. Stream ID: " + to_string(csid) + ".");
+                        "Protocol control message: Abort. Stream ID: {}.",
+                        csid);
+
+                    // Discard the partially received message of the chunk stream.
+                    ChunkStreamState* stream = session.chunkStreams.Find(csid);
+                    if (stream != nullptr && stream->message != nullptr)
+                    {
+                        session.partialBytes -= stream->message->capacity;
+                        stream->message->pool->Release(stream->message);
+                        stream->message = nullptr;
+                    }
                     // vector<char> data = ProtocolControlMessage::vAbort(csid);
-                    // SendChunk(data.data(), data.size(), session, ProtocolControlMessage::Abort);
+                    // SendChunk(move(data), session, ProtocolControlMessage::Abort);
                     break;
                 };
                 case ProtocolControlMessage::Type::Acknowledgement:
@@ -442,16 +1088,17 @@ namespace RTMP
                         session.lastChunk->data, 
                         false, 
                         chunk.messageHeader.message_length);
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
-                        "Protocol control message: Acknowledgement. Sequence number -> " + to_string(seqnumber));
+                        "Protocol control message: Acknowledgement. Sequence number -> {}.",
+                        seqnumber);
                     break;
                 };
                 case ProtocolControlMessage::Type::WindowAcknowledgementSize:
                 {
                     int WindowAcknowledgementSize = session.Bandwidth;
 
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "Protocol control message: Window Acknowledgement size.");
 
@@ -462,12 +1109,12 @@ namespace RTMP
                 {
                     int bandwith = session.Bandwidth;
 
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "Protocol control message: Set peer Bandwidth.");
 
                     // vector<char> data = ProtocolControlMessage::vSetPeerBandwidth(bandwith, ProtocolControlMessage::PeerBandwithLimitType::Hard);
-                    // SendChunk(data.data(), data.size(), session, ProtocolControlMessage::SetPeerBandwidth);
+                    // SendChunk(move(data), session, ProtocolControlMessage::SetPeerBandwidth);
                     break;
                 }
             };
@@ -478,59 +1125,62 @@ namespace RTMP
             switch (chunk.messageHeader.message_type_id)
             {
                 case Message::Type::AudioMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "Audio message.");
+                    HandleAudioMessage(chunk, session);
                     break;
                 case Message::Type::VideoMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "Video message.");
+                    HandleVideoMessage(chunk, session);
                     break;
                 case Message::Type::AggregateMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "Aggregate message.");
+                    status += HandleAggregateMessage(chunk, session);
                     break;
                 case Message::Type::AMF0CommandMessage:
                 {
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "AMF0 Command message.");
-                    Utils::FormatedPrint::PrintBytes<unsigned char>(chunk.data, chunk.messageHeader.message_length);
-                    
-                    Netconnection::Command* command = Utils::AMF0Decoder::DecodeCommand(
-                        chunk.data, 
-                        chunk.messageHeader.message_length);
-                    session.pendingCommand = command;
                     
-                    status += HandleCommandMessage(command, session);
-
-                    printf("\n");
+                    status += DispatchCommand(chunk.data, chunk.messageHeader.message_length,
+                        Netconnection::ObjectEncoding::AMF0, session);
                     break;
                 }
                 case Message::Type::AMF3CommandMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "AMF3 Command message.");
+
+                    // Format byte, then AMF0 switching to AMF3.
+                    if (chunk.messageHeader.message_length > 0)
+                        status += DispatchCommand(chunk.data + 1, chunk.messageHeader.message_length - 1,
+                            Netconnection::ObjectEncoding::AMF3, session);
                     break;
                 case Message::Type::AMF0DataMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "AMF0 Data message.");
+                    HandleDataMessage(chunk, session);
                     break;
                 case Message::Type::AMF3DataMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "AMF3 Data message.");
+                    HandleAMF3DataMessage(chunk, session);
                     break;
                 case Message::Type::AMF0SharedObjectMessage:
-                    Utils::FormatedPrint::PrintFormated(
+                    RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "AMF0 Shared object message.");
                     break;
                 case Message::Type::AMF3SharedObjectMessage:
-                Utils::FormatedPrint::PrintFormated(
+                RTMP_TRACE(Debug, Handler,
                         "Handler::HandleChunk", 
                         "AMF3 Shared object message.");
                     break;
@@ -542,50 +1192,37 @@ namespace RTMP
 
     int Handler::SendHandshake(Session& session)
     {
-        char* data;
-        Handshake::Handshake& handshake = session.handshake;
+        Handshake::Handshake* handshake = session.handshake.get();
 
-        switch (handshake.state)
+        switch (session.handshakeState)
         {
-            case Handshake::State::Uninitialized:
+            case Handshake::State::VersionSent:
             {
-                data = new char[3073];
+                if (handshake == nullptr)
+                    return -1;
 
                 /**
+                 * S0: version.
                  * S1: 
                  *  - time: 4 bytes.
                  *  - zero: 4 bytes.
                  *  - random bytes: 1528 bytes.
+                 * S2: echo of C1, already in place.
                  **/
                 char* randomData = Utils::BitOperations::GenerateRandom8BitBytes(RANDOM_BYTES_COUNT);
 
-                // S0
-                data[0] = handshake.C0.version;
-                
-                for (int i = 0; i < TIME_BYTES_COUNT; i++)
-                {
-                    // S1
-                    data[i + 1] = 0;
-
-                    // S2
-                    data[i + 1537] = handshake.C1.time[i];
-                    data[i + 1537 + TIME_BYTES_COUNT] = handshake.C1.time[i];
-                }
-
-                for (int i = 0; i < RANDOM_BYTES_COUNT; i++)
-                {
-                    // S1
-                    data[i + 5] = randomData[i];
-
-                    // S2
-                    data[i + 1537 + (2 * TIME_BYTES_COUNT)] = handshake.C1.randomBytes[i];
-                }
+                // Version 3 is answered whatever the client asked for.
+                handshake->S0.version = 3;
+                memset(handshake->S1.time, 0, TIME_BYTES_COUNT);
+                memset(handshake->S1.zero, 0, TIME_BYTES_COUNT);
+                memcpy(handshake->S1.randomBytes, randomData, RANDOM_BYTES_COUNT);
+                delete[] randomData;
 
-                return SendData(session.socket, data, 3073);
+                return SendData(session, (const char*)handshake->Response(), Handshake::ResponseSize);
                 break;
             };
 
-            case Handshake::State::VersionSent:
+            case Handshake::State::Uninitialized:
             {
                 return 0;
                 break;
@@ -600,7 +1237,7 @@ namespace RTMP
 
             case Handshake::State::Done:
             {
-                Utils::FormatedPrint::PrintFormated(
+                RTMP_TRACE(Debug, Handler,
                         "Handler::SendHandshake", 
                         "Handshake is done. No data to send.");
                 return 0;
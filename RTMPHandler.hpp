@@ -12,11 +12,19 @@
 #include "RTMPHandshake.hpp"
 #include "RTMPMessage.hpp"
 #include "RTMPResponse.hpp"
+#include "RTMPTransport.hpp"
+#include "RTMPSerializer.hpp"
+#include "RTMPStreamRegistry.hpp"
+#include "RTMPVod.hpp"
+#include "RTMPEndian.hpp"
+#include "RTMPAMF3.hpp"
 
 #include "../utils/Bit.hpp"
 #include "../utils/amf0.hpp"
 
 #include <iterator>
+#include <cstring>
+#include <memory>
 
 
 /**
@@ -39,9 +47,12 @@ namespace RTMP
             /**
              * Handle incoming data.
              **/
-            static int HandleCommandMessage(Netconnection::Command*, Session&);
-            static void HandleVideoMessage(unsigned char*, Session&);
-            static void HandleAudioMessage(unsigned char*, Session&);
+            static int HandleCommandMessage(const AMF0Command& command, Session&);
+            static void HandleVideoMessage(Chunk& chunk, Session&);
+            static void HandleAudioMessage(Chunk& chunk, Session&);
+            static void HandleDataMessage(Chunk& chunk, Session&);
+            static void HandleAMF3DataMessage(Chunk& chunk, Session&);
+            static int HandleAggregateMessage(Chunk& chunk, Session&);
 
             static int InitializeConnect(Session& session);
 
@@ -50,8 +61,43 @@ namespace RTMP
             /**
              * Send data.
              **/
-            static int SendData(SOCKET socket, char* data, int length);
-            static int SendChunk(char* data, int length, Session& session, int message_type);
+            static int SendData(Session& session, const char* data, int length);
+            static int SendData(Session& session, const char* data, int length, shared_ptr<const void> owner);
+            static int SendChunk(vector<char> data, Session& session, int message_type);
+
+            /**
+             * Send a message as chunks of the session's outbound chunk size.
+             * `chunk` gives the chunk stream ID, the message header and the
+             * absolute timestamp (chunk.timestamp); the header format is picked
+             * from what was last sent on the chunk stream. The payload is
+             * referenced, kept alive by `owner` until written.
+             **/
+            static int SendMessage(Session& session, const Chunk& chunk, const unsigned char* payload, size_t length, shared_ptr<const void> owner);
+
+            /**
+             * Send a published message to a subscriber, on the chunk stream
+             * of its type and the subscriber's message stream. The chunked
+             * payload is shared with every other subscriber.
+             **/
+            static int SendMedia(Session& session, const shared_ptr<const MediaMessage>& message);
+
+            /**
+             * Detach a session from the live streams it publishes or plays.
+             * Called by the transport before the session is deleted.
+             **/
+            static void CloseSession(Session& session);
+
+            /**
+             * Queue the next window of the file the session plays, if any.
+             * Called by the transport once the outbound queue is written.
+             **/
+            static void HandleDrained(Session& session);
+
+            /**
+             * Tell a subscriber the live stream it plays was unpublished,
+             * and detach it. Called from the subscriber's thread.
+             **/
+            static void HandleUnpublished(Session& session);
 
             static int SendCommandMessage(Netconnection::Command*, Session&);
             static int SendHandshake(Session&);
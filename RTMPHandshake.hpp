@@ -3,9 +3,16 @@
  **/
 #pragma once
 
+#include <cstddef>
+
 #define RANDOM_BYTES_COUNT 1528
 #define TIME_BYTES_COUNT 4
 
+/**
+ * C1, S1, C2 and S2 size.
+ **/
+#define HANDSHAKE_PACKET_SIZE 1536
+
 /**
  * Definition of Handshake formats.
  **/
@@ -29,40 +36,50 @@ namespace Handshake
     // C0 & S0
     struct F0 
     {
-        unsigned short int version:3;
+        unsigned char version;
     };
 
     // C1 & S1
     struct F1 
     {
-        unsigned int time[TIME_BYTES_COUNT];
-        unsigned int randomBytes[RANDOM_BYTES_COUNT];
+        unsigned char time[TIME_BYTES_COUNT];
+        unsigned char zero[TIME_BYTES_COUNT];
+        unsigned char randomBytes[RANDOM_BYTES_COUNT];
     };
 
     // C2 & S2
     struct F2
     {
-        unsigned int time[TIME_BYTES_COUNT];
-        unsigned int time2[TIME_BYTES_COUNT];
-        unsigned int randomBytes[RANDOM_BYTES_COUNT];
+        unsigned char time[TIME_BYTES_COUNT];
+        unsigned char time2[TIME_BYTES_COUNT];
+        unsigned char randomBytes[RANDOM_BYTES_COUNT];
     };
 
+    /**
+     * Handshake data, in wire format.
+     *
+     * Allocated when a connection starts and released once the handshake
+     * is done. S0, S1 and S2 are contiguous so they go out in one write.
+     * S2 echoes C1, so C1 is read straight into S2; C2 echoes S1 and is
+     * compared against it where it was received.
+     **/
     struct Handshake
     {
-        // Status
-        State state = State::Uninitialized;
-
-        // 
         F0 C0;
-        F0& S0 = C0;
 
-        //
-        F1 C1;
+        F0 S0;
         F1 S1;
-
-        //
-        F2 C2;
         F2 S2;
-        
+
+        const unsigned char* Response() const { return &S0.version; }
     };
+
+    static_assert(sizeof(F1) == HANDSHAKE_PACKET_SIZE, "F1 must match the wire format.");
+    static_assert(sizeof(F2) == HANDSHAKE_PACKET_SIZE, "F2 must match the wire format.");
+    static_assert(offsetof(Handshake, S2) - offsetof(Handshake, S0) == 1 + HANDSHAKE_PACKET_SIZE, "S0, S1 and S2 must be contiguous.");
+
+    /**
+     * S0 + S1 + S2.
+     **/
+    static constexpr size_t ResponseSize = 1 + 2 * HANDSHAKE_PACKET_SIZE;
 }
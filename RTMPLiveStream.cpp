@@ -0,0 +1,382 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of live stream fan-out.
+ **/
+
+#include "RTMPLiveStream.hpp"
+#include "RTMPHandler.hpp"
+#include "RTMPEndian.hpp"
+
+#include <algorithm>
+
+namespace RTMP
+{
+    LiveStream::Group& LiveStream::GroupOf(Transport* transport)
+    {
+        for (unique_ptr<Group>& group : groups)
+        {
+            if (group->transport == transport)
+                return *group;
+        }
+
+        // Groups live as long as the stream; their number is bounded by the threads.
+        groups.push_back(unique_ptr<Group>(new Group));
+        groups.back()->transport = transport;
+        return *groups.back();
+    }
+
+    void LiveStream::Subscribe(Session& session)
+    {
+        vector<shared_ptr<const MediaMessage>> primer;
+        bool unpublished = false;
+        {
+            lock_guard<mutex> guard(lock);
+
+            // Ended since the session found it: never detached, so not attached.
+            unpublished = ended;
+            if (!unpublished)
+            {
+                primer.reserve(pictures.size() + 3);
+                if (metadata)
+                    primer.push_back(metadata);
+                if (videoHeader)
+                    primer.push_back(videoHeader);
+                if (audioHeader)
+                    primer.push_back(audioHeader);
+                primer.insert(primer.end(), pictures.begin(), pictures.end());
+
+                // Messages sent so far were cached, or dropped from the cache, before it joined.
+                Group& group = GroupOf(session.transport);
+                group.subscribers.push_back(Subscriber { &session, sequence });
+                group.members++;
+            }
+        }
+
+        if (unpublished)
+        {
+            Handler::HandleUnpublished(session);
+            return;
+        }
+
+        /**
+         * Messages published from now on are delivered by this thread after
+         * this returns, so the primer is queued before them.
+         **/
+        for (const shared_ptr<const MediaMessage>& message : primer)
+            Handler::SendMedia(session, message);
+    }
+
+    void LiveStream::Unsubscribe(Session& session)
+    {
+        lock_guard<mutex> guard(lock);
+
+        Group& group = GroupOf(session.transport);
+        vector<Subscriber>::iterator position = find_if(group.subscribers.begin(), group.subscribers.end(),
+            [&session](const Subscriber& subscriber) { return subscriber.session == &session; });
+        if (position == group.subscribers.end())
+            return;
+
+        group.subscribers.erase(position);
+        group.members--;
+    }
+
+    void LiveStream::End(Transport* origin)
+    {
+        // What is left pending, then the end of the stream.
+        shared_ptr<const MediaMessage> outgoing[2];
+        size_t count = 0;
+
+        uint64_t first = 0;
+
+        Group* local = nullptr;
+        {
+            lock_guard<mutex> guard(lock);
+            ended = true;
+
+            for (PendingAggregate& pending : aggregates)
+            {
+                if (!pending.bytes.empty())
+                    outgoing[count++] = FlushAggregate(pending);
+            }
+            local = Send(outgoing, count, origin, first);
+
+            for (unique_ptr<Group>& group : groups)
+            {
+                if (group->members == 0 || group->transport == origin)
+                    continue;
+
+                // Queued after the messages already posted to the group.
+                Group* remote = group.get();
+                shared_ptr<LiveStream> self = shared_from_this();
+                remote->transport->Post([self, remote]() {
+                    self->Detach(*remote);
+                });
+            }
+        }
+
+        if (local != nullptr)
+        {
+            for (size_t i = 0; i < count; i++)
+                Deliver(*local, outgoing[i], first + i);
+            Detach(*local);
+        }
+    }
+
+    void LiveStream::Detach(Group& group)
+    {
+        // Walked from a copy: each session drops its reference to the stream.
+        vector<Subscriber> subscribers;
+        subscribers.swap(group.subscribers);
+        {
+            lock_guard<mutex> guard(lock);
+            group.members = 0;
+        }
+
+        for (Subscriber& subscriber : subscribers)
+            Handler::HandleUnpublished(*subscriber.session);
+    }
+
+    void LiveStream::SetAggregation(unsigned int window, size_t largestMessage)
+    {
+        lock_guard<mutex> guard(lock);
+        aggregationWindow = window;
+        aggregationLimit = largestMessage;
+    }
+
+    void LiveStream::Publish(shared_ptr<const MediaMessage> message, Transport* origin)
+    {
+        // Pending aggregates, then the message itself unless it was packed.
+        shared_ptr<const MediaMessage> outgoing[3];
+        size_t count = 0;
+
+        // Aggregates started by the message, flushed by a timer if nothing follows.
+        unsigned int window = 0;
+        uint64_t started[2] = {};
+
+        uint64_t first = 0;
+        Group* local = nullptr;
+        {
+            lock_guard<mutex> guard(lock);
+
+            if (aggregationWindow == 0)
+                outgoing[count++] = message;
+            else
+                count = Aggregate(message, outgoing);
+
+            for (PendingAggregate& pending : aggregates)
+            {
+                if (pending.bytes.empty() || pending.armed)
+                    continue;
+                pending.armed = true;
+                window = aggregationWindow;
+                started[&pending - aggregates] = pending.generation;
+            }
+
+            local = Send(outgoing, count, origin, first);
+        }
+
+        // The publisher's group belongs to this thread.
+        if (local != nullptr)
+        {
+            for (size_t i = 0; i < count; i++)
+                Deliver(*local, outgoing[i], first + i);
+        }
+
+        if (origin == nullptr)
+            return;
+        for (size_t i = 0; i < 2; i++)
+        {
+            if (started[i] == 0)
+                continue;
+            shared_ptr<LiveStream> self = shared_from_this();
+            uint64_t generation = started[i];
+            origin->After(window, [self, i, generation, origin]() {
+                self->FlushExpired(i, generation, origin);
+            });
+        }
+    }
+
+    void LiveStream::FlushExpired(size_t media, uint64_t generation, Transport* origin)
+    {
+        shared_ptr<const MediaMessage> outgoing;
+        uint64_t first = 0;
+        Group* local = nullptr;
+        {
+            lock_guard<mutex> guard(lock);
+
+            // Flushed meanwhile by a later message, or the end of the stream.
+            PendingAggregate& pending = aggregates[media];
+            if (pending.bytes.empty() || pending.generation != generation)
+                return;
+
+            outgoing = FlushAggregate(pending);
+            local = Send(&outgoing, 1, origin, first);
+        }
+
+        if (local != nullptr)
+            Deliver(*local, outgoing, first);
+    }
+
+    LiveStream::Group* LiveStream::Send(const shared_ptr<const MediaMessage>* outgoing, size_t count, Transport* origin, uint64_t& first)
+    {
+        Group* local = nullptr;
+
+        /**
+         * Cached as numbered: a subscriber joining before a posted delivery
+         * runs has the message in its primer already, and skips it.
+         **/
+        first = sequence + 1;
+        for (size_t i = 0; i < count; i++)
+            Cache(outgoing[i]);
+        sequence += count;
+
+        for (unique_ptr<Group>& group : groups)
+        {
+            if (group->members == 0)
+                continue;
+
+            if (group->transport == origin)
+            {
+                local = group.get();
+                continue;
+            }
+
+            // Delivered by the group's own thread; the task keeps the stream alive.
+            Group* remote = group.get();
+            shared_ptr<LiveStream> self = shared_from_this();
+            for (size_t i = 0; i < count; i++)
+            {
+                shared_ptr<const MediaMessage> delivered = outgoing[i];
+                uint64_t number = first + i;
+                remote->transport->Post([self, remote, delivered, number]() {
+                    Deliver(*remote, delivered, number);
+                });
+            }
+        }
+        return local;
+    }
+
+    size_t LiveStream::Aggregate(const shared_ptr<const MediaMessage>& message, shared_ptr<const MediaMessage>* outgoing)
+    {
+        size_t count = 0;
+        size_t length = message->Length();
+
+        // Keyframes and sequence headers stay on their own, where the egress budget can see them.
+        bool media = message->Type() == Message::Type::AudioMessage || message->Type() == Message::Type::VideoMessage;
+        bool packable = media && !message->IsKeyframe() && !message->IsSequenceHeader()
+            && length <= aggregationLimit;
+        size_t own = message->Type() == Message::Type::VideoMessage ? 1 : 0;
+
+        /**
+         * Order is kept within a media: whatever cannot join goes after the
+         * pending aggregate of its media. Data messages go after both.
+         **/
+        for (size_t i = 0; i < 2; i++)
+        {
+            PendingAggregate& pending = aggregates[i];
+            if (pending.bytes.empty() || (media && i != own))
+                continue;
+            if (!packable || pending.bytes.size() + AggregateTagOverhead + length > MaximumAggregateBytes)
+                outgoing[count++] = FlushAggregate(pending);
+        }
+
+        if (!packable)
+        {
+            outgoing[count++] = message;
+            return count;
+        }
+
+        PendingAggregate& pending = aggregates[own];
+        if (pending.bytes.empty())
+        {
+            pending.start = message->Timestamp();
+            pending.pool = &message->Pool();
+        }
+
+        /**
+         * FLV tag: type, data size, timestamp (24 bits, then the high byte),
+         * stream ID (always 0), data, then the size of the tag.
+         **/
+        unsigned int timestamp = message->Timestamp();
+        unsigned char header[11];
+        header[0] = (unsigned char)message->Type();
+        Endian::Store24BE(header + 1, (unsigned int)length);
+        Endian::Store24BE(header + 4, timestamp & 0xFFFFFF);
+        header[7] = (unsigned char)(timestamp >> 24);
+        Endian::Store24BE(header + 8, 0);
+
+        unsigned char trailer[4];
+        Endian::Store32BE(trailer, (unsigned int)(11 + length));
+
+        pending.bytes.insert(pending.bytes.end(), header, header + sizeof(header));
+        pending.bytes.insert(pending.bytes.end(), message->Data(), message->Data() + length);
+        pending.bytes.insert(pending.bytes.end(), trailer, trailer + sizeof(trailer));
+
+        if (timestamp - pending.start >= aggregationWindow)
+            outgoing[count++] = FlushAggregate(pending);
+        return count;
+    }
+
+    shared_ptr<const MediaMessage> LiveStream::FlushAggregate(PendingAggregate& pending)
+    {
+        shared_ptr<const MediaMessage> message = make_shared<MediaMessage>(*pending.pool,
+            Message::Type::AggregateMessage, pending.start, pending.bytes.data(), pending.bytes.size());
+        pending.bytes.clear();
+        pending.armed = false;
+        pending.generation++;
+        return message;
+    }
+
+    void LiveStream::Cache(const shared_ptr<const MediaMessage>& message)
+    {
+        if (message->IsMetadata())
+        {
+            metadata = message;
+            return;
+        }
+
+        if (message->IsSequenceHeader())
+        {
+            if (message->Type() == Message::Type::VideoMessage)
+                videoHeader = message;
+            else
+                audioHeader = message;
+            return;
+        }
+
+        if (message->Type() != Message::Type::VideoMessage && message->Type() != Message::Type::AudioMessage
+            && message->Type() != Message::Type::AggregateMessage)
+            return;
+
+        // A keyframe starts a new group of pictures; nothing is kept before the first one.
+        if (message->IsKeyframe())
+        {
+            pictures.clear();
+            picturesBytes = 0;
+        }
+        else if (pictures.empty())
+        {
+            return;
+        }
+
+        picturesBytes += message->Length();
+        if (picturesBytes > MaximumCacheBytes)
+        {
+            pictures.clear();
+            picturesBytes = 0;
+            return;
+        }
+        pictures.push_back(message);
+    }
+
+    void LiveStream::Deliver(Group& group, const shared_ptr<const MediaMessage>& message, uint64_t number)
+    {
+        for (Subscriber& subscriber : group.subscribers)
+        {
+            if (number > subscriber.joined)
+                Handler::SendMedia(*subscriber.session, message);
+        }
+    }
+}
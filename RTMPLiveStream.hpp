@@ -0,0 +1,178 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Live streams: fan-out of a publisher's messages to its subscribers.
+ **/
+
+#include "RTMPMedia.hpp"
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    struct Session;
+    class Transport;
+
+    /**
+     * Stream published by one session and played by any number of others.
+     *
+     * Subscribers are grouped by the transport (event loop thread) they
+     * belong to; a group is only walked by its own thread. A message is
+     * delivered in place to the publisher's group and posted once to every
+     * other group, so fan-out costs one post per thread and one queue
+     * reference per subscriber.
+     *
+     * The stream also caches what a new subscriber needs to start decoding
+     * right away: the metadata, the sequence headers and every message since
+     * the last keyframe. Subscribers are sent this cache when they join.
+     **/
+    class LiveStream : public enable_shared_from_this<LiveStream>
+    {
+        private:
+            struct Subscriber
+            {
+                Session* session;
+
+                // Number of the last message sent before it joined.
+                uint64_t joined;
+            };
+
+            struct Group
+            {
+                Transport* transport;
+
+                // Subscribers, owned by the transport's thread.
+                vector<Subscriber> subscribers;
+
+                // Subscriber count, under the stream lock.
+                size_t members = 0;
+            };
+
+            string name;
+
+            // Guards the group list and member counts; sessions are added and
+            // removed rarely, messages only take it to find the groups.
+            mutex lock;
+            vector<unique_ptr<Group>> groups;
+
+            // Set once the publisher left; nobody subscribes any more.
+            bool ended = false;
+
+            // Number of the last message sent, under the stream lock.
+            uint64_t sequence = 0;
+
+            /**
+             * Priming cache, under the stream lock.
+             * The group of pictures is dropped past MaximumCacheBytes until the next keyframe.
+             **/
+            static constexpr size_t MaximumCacheBytes = 16 * 1024 * 1024;
+
+            shared_ptr<const MediaMessage> metadata;
+            shared_ptr<const MediaMessage> videoHeader;
+            shared_ptr<const MediaMessage> audioHeader;
+            vector<shared_ptr<const MediaMessage>> pictures;
+            size_t picturesBytes = 0;
+
+            /**
+             * Egress aggregation, under the stream lock. Off while the window is 0.
+             * Small audio and video messages are packed as FLV tags into one
+             * aggregate message per window and media: the egress budget
+             * drops video aggregates like inter frames, never audio ones.
+             * An aggregate is flushed by the message past its window, a timer
+             * of the publisher's transport when none comes, or the end of the stream.
+             **/
+            static constexpr size_t AggregateTagOverhead = 15;
+            static constexpr size_t MaximumAggregateBytes = 64 * 1024;
+
+            unsigned int aggregationWindow = 0;
+            size_t aggregationLimit = 0;
+
+            struct PendingAggregate
+            {
+                vector<unsigned char> bytes;
+                unsigned int start = 0;
+                BufferPool* pool = nullptr;
+
+                /**
+                 * Whether a flush timer runs for the aggregate, and which
+                 * aggregate it was: the count of those flushed before it.
+                 **/
+                bool armed = false;
+                uint64_t generation = 1;
+            };
+
+            // Audio, then video.
+            PendingAggregate aggregates[2];
+
+            Group& GroupOf(Transport* transport);
+            void Cache(const shared_ptr<const MediaMessage>& message);
+
+            /**
+             * Pack `message` if it is small enough; fill `outgoing` with the
+             * messages to deliver now, in order. Returns their count, up to 3.
+             **/
+            size_t Aggregate(const shared_ptr<const MediaMessage>& message, shared_ptr<const MediaMessage>* outgoing);
+            shared_ptr<const MediaMessage> FlushAggregate(PendingAggregate& pending);
+
+            /**
+             * Flush the aggregate `generation` of `media` once its window
+             * passed, if nothing flushed it meanwhile. Run by the publisher's transport.
+             **/
+            void FlushExpired(size_t media, uint64_t generation, Transport* origin);
+
+            /**
+             * Number, cache and post `count` messages to every other group
+             * than the one of `origin`, which is returned; `first` is set to
+             * the number of the first message. Under the stream lock.
+             **/
+            Group* Send(const shared_ptr<const MediaMessage>* outgoing, size_t count, Transport* origin, uint64_t& first);
+
+            // Send message `number` to the subscribers that joined before it.
+            static void Deliver(Group& group, const shared_ptr<const MediaMessage>& message, uint64_t number);
+            void Detach(Group& group);
+
+        public:
+            LiveStream(const string& name) : name(name) {};
+
+            LiveStream(const LiveStream&) = delete;
+            LiveStream& operator=(const LiveStream&) = delete;
+
+            const string& Name() const { return name; }
+
+            /**
+             * Pack audio and video messages of up to `largestMessage` bytes
+             * into aggregate messages spanning `window` milliseconds, to save
+             * headers and writes on low bitrate streams. 0 turns it off.
+             **/
+            void SetAggregation(unsigned int window, size_t largestMessage);
+
+            /**
+             * Start or stop sending the stream to `session`.
+             * Called from the session's thread; a new subscriber is first
+             * sent the priming cache, or told the stream ended.
+             **/
+            void Subscribe(Session& session);
+            void Unsubscribe(Session& session);
+
+            /**
+             * Send `message` to every subscriber. Called from the publisher's
+             * thread, whose transport is `origin`.
+             **/
+            void Publish(shared_ptr<const MediaMessage> message, Transport* origin);
+
+            /**
+             * End the stream once its publisher left: every subscriber is
+             * told and detached, from its own thread. Called from the
+             * publisher's thread, whose transport is `origin`.
+             **/
+            void End(Transport* origin);
+    };
+}
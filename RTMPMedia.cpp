@@ -0,0 +1,185 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of published media messages.
+ **/
+
+#include "RTMPMedia.hpp"
+#include "RTMPMessage.hpp"
+#include "RTMPSerializer.hpp"
+#include "RTMPEndian.hpp"
+
+#include <cstring>
+
+namespace RTMP
+{
+    MediaMessage::MediaMessage(BufferPool& pool, int type, unsigned int timestamp, const unsigned char* data, size_t length)
+        : type(type), timestamp(timestamp)
+    {
+        payload = pool.Acquire(length);
+        if (length)
+            memcpy(payload->Data(), data, length);
+        payload->length = length;
+    }
+
+    MediaMessage::~MediaMessage()
+    {
+        Variant* variant = variants.load(memory_order_acquire);
+        while (variant != nullptr)
+        {
+            Variant* next = variant->next;
+            variant->body->pool->Release(variant->body);
+            delete variant;
+            variant = next;
+        }
+        payload->pool->Release(payload);
+    }
+
+    Slice MediaMessage::Serialized(size_t chunkSize, unsigned int csid, bool extended, unsigned int extendedTimestamp, BufferPool& pool) const
+    {
+        size_t length = payload->length;
+
+        // Single chunk: the payload itself.
+        if (length <= chunkSize)
+        {
+            Slice slice;
+            slice.data = payload->Data();
+            slice.length = length;
+            return slice;
+        }
+
+        Variant* head = variants.load(memory_order_acquire);
+        for (Variant* variant = head; variant != nullptr; variant = variant->next)
+        {
+            if (variant->chunkSize == chunkSize && variant->csid == csid && variant->extended == extended
+                && (!extended || variant->extendedTimestamp == extendedTimestamp))
+            {
+                Slice slice;
+                slice.data = variant->body->Data();
+                slice.length = variant->body->length;
+                return slice;
+            }
+        }
+
+        /**
+         * Continuation header, the same for every chunk.
+         **/
+        Chunk continuation;
+        continuation.basicHeader.fmt = ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3;
+        continuation.basicHeader.csid = csid;
+        continuation.hasExtendedTimestamp = extended;
+        continuation.extendedTimestamp = (int)extendedTimestamp;
+
+        unsigned char header[MAX_CHUNK_HEADER_SIZE];
+        size_t headerLength = Serializer::EncodeChunkHeader(continuation, header);
+
+        size_t continuations = (length - 1) / chunkSize;
+        MessageBuffer* body = pool.Acquire(length + continuations * headerLength);
+
+        const unsigned char* source = payload->Data();
+        unsigned char* destination = body->Data();
+        memcpy(destination, source, chunkSize);
+        destination += chunkSize;
+
+        for (size_t offset = chunkSize; offset < length; offset += chunkSize)
+        {
+            size_t slice = length - offset < chunkSize ? length - offset : chunkSize;
+            memcpy(destination, header, headerLength);
+            memcpy(destination + headerLength, source + offset, slice);
+            destination += headerLength + slice;
+        }
+        body->length = destination - body->Data();
+
+        Variant* variant = new Variant { chunkSize, csid, extended, extendedTimestamp, body, head };
+
+        // Another thread may have added a variant meanwhile; both stay valid.
+        while (!variants.compare_exchange_weak(variant->next, variant, memory_order_release, memory_order_acquire));
+
+        Slice slice;
+        slice.data = body->Data();
+        slice.length = body->length;
+        return slice;
+    }
+
+    bool MediaMessage::IsKeyframe(int type, const unsigned char* data, size_t length)
+    {
+        // Video tag: frame type in the high nibble, 1 for a keyframe.
+        return type == Message::Type::VideoMessage && length > 0
+            && (data[0] >> 4) == 1;
+    }
+
+    bool MediaMessage::IsDisposable() const
+    {
+        const unsigned char* data = payload->Data();
+        size_t length = payload->length;
+        if (type != Message::Type::VideoMessage || length < 1)
+            return false;
+
+        unsigned int frameType = data[0] >> 4;
+        if (frameType == 3)
+            return true;
+
+        // AVC inter frame NAL units: 5-byte video tag header, then length-prefixed units.
+        if (frameType != 2 || (data[0] & 0x0F) != 7 || length < 5 || data[1] != 1)
+            return false;
+
+        size_t offset = 5;
+        bool found = false;
+        while (offset + 4 < length)
+        {
+            size_t unit = Endian::Load32BE(data + offset);
+            offset += 4;
+            if (unit == 0 || unit > length - offset)
+                return false;
+
+            // nal_ref_idc: bits 5-6 of the NAL unit header.
+            if (data[offset] & 0x60)
+                return false;
+
+            found = true;
+            offset += unit;
+        }
+        return found;
+    }
+
+    bool MediaMessage::IsSequenceHeader(int type, const unsigned char* data, size_t length)
+    {
+        if (length < 2)
+            return false;
+
+        if (type == Message::Type::VideoMessage)
+        {
+            // AVC (7) or HEVC (12), packet type 0.
+            unsigned int codec = data[0] & 0x0F;
+            return (codec == 7 || codec == 12) && data[1] == 0;
+        }
+        if (type == Message::Type::AudioMessage)
+        {
+            // AAC (10), packet type 0.
+            return (data[0] >> 4) == 10 && data[1] == 0;
+        }
+        return false;
+    }
+
+    bool MediaMessage::IsMetadata(int type, const unsigned char* data, size_t length)
+    {
+        // AMF0 string "onMetaData" first.
+        static const unsigned char Name[] = { 0x02, 0x00, 0x0A, 'o', 'n', 'M', 'e', 't', 'a', 'D', 'a', 't', 'a' };
+        return type == Message::Type::AMF0DataMessage && length >= sizeof(Name)
+            && memcmp(data, Name, sizeof(Name)) == 0;
+    }
+
+    unsigned int MediaMessage::ChunkStream(int type)
+    {
+        switch (type)
+        {
+            case Message::Type::AudioMessage:
+                return 4;
+            case Message::Type::VideoMessage:
+                return 6;
+            default:
+                return 5;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Published media messages.
+ **/
+
+#include "RTMPBufferPool.hpp"
+#include "RTMPOutbound.hpp"
+
+#include <atomic>
+#include <cstddef>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Audio, video or data message received from a publisher, shared by
+     * every subscriber it is sent to.
+     *
+     * The payload is copied once from the publisher's receive buffers and
+     * never changes afterwards. A message longer than a chunk is serialized
+     * once per variant (chunk size, chunk stream ID, continuation header);
+     * subscribers reference the serialized bytes and only write their own
+     * first chunk header, which depends on what each one was last sent.
+     **/
+    class MediaMessage
+    {
+        private:
+            /**
+             * Chunked form of the payload: the first chunk's payload, then
+             * every continuation chunk with its Type 3 header.
+             **/
+            struct Variant
+            {
+                size_t chunkSize;
+                unsigned int csid;
+                bool extended;
+                unsigned int extendedTimestamp;
+
+                MessageBuffer* body;
+                Variant* next;
+            };
+
+            int type;
+            unsigned int timestamp;
+            MessageBuffer* payload;
+
+            // Lock-free list of variants, readers may race to add one.
+            mutable atomic<Variant*> variants { nullptr };
+
+        public:
+            MediaMessage(BufferPool& pool, int type, unsigned int timestamp, const unsigned char* data, size_t length);
+            ~MediaMessage();
+
+            MediaMessage(const MediaMessage&) = delete;
+            MediaMessage& operator=(const MediaMessage&) = delete;
+
+            int Type() const { return type; }
+            unsigned int Timestamp() const { return timestamp; }
+            const unsigned char* Data() const { return payload->Data(); }
+            size_t Length() const { return payload->length; }
+
+            // Pool the payload was taken from.
+            BufferPool& Pool() const { return *payload->pool; }
+
+            /**
+             * Bytes following the first chunk header when the message is sent
+             * in chunks of `chunkSize` on chunk stream `csid`. Continuation
+             * headers repeat `extendedTimestamp` when `extended` is set.
+             *
+             * Built on first use, buffers taken from `pool`. Valid as long as
+             * the message is.
+             **/
+            Slice Serialized(size_t chunkSize, unsigned int csid, bool extended, unsigned int extendedTimestamp, BufferPool& pool) const;
+
+            /**
+             * FLV tag properties of the payload.
+             * Keyframes start a group of pictures; sequence headers hold
+             * the decoder configuration (AVC/HEVC or AAC) and are needed
+             * before any frame can be decoded.
+             **/
+            bool IsKeyframe() const { return IsKeyframe(type, payload->Data(), payload->length); }
+            bool IsSequenceHeader() const { return IsSequenceHeader(type, payload->Data(), payload->length); }
+
+            /**
+             * Video frame no other frame references: a disposable inter frame,
+             * or an AVC frame whose NAL units all have a nal_ref_idc of 0
+             * (4-byte NAL unit lengths assumed). Can be dropped without
+             * breaking decoding.
+             **/
+            bool IsDisposable() const;
+
+            bool IsMetadata() const { return IsMetadata(type, payload->Data(), payload->length); }
+
+            /**
+             * Same, for a payload that is not held in a message.
+             **/
+            static bool IsKeyframe(int type, const unsigned char* data, size_t length);
+            static bool IsSequenceHeader(int type, const unsigned char* data, size_t length);
+            static bool IsMetadata(int type, const unsigned char* data, size_t length);
+
+            /**
+             * Chunk stream the messages of a type are sent on.
+             **/
+            static unsigned int ChunkStream(int type);
+    };
+}
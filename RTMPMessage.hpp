@@ -116,12 +116,15 @@ namespace RTMP
             
             /**
              * AMF3 Encoding
+             * 
+             * The payload starts with a format byte, 0, then is AMF0 whose
+             * values may switch to AMF3.
              **/
-            AMF3DataMessage         = 0x0D,
+            AMF3DataMessage         = 0x0F,
 
-            AMF3SharedObjectMessage = 0x0E,
+            AMF3SharedObjectMessage = 0x10,
 
-            AMF3CommandMessage      = 0x0F,
+            AMF3CommandMessage      = 0x11,
         };
 
         enum UserControlMessageEventsTypes
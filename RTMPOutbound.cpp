@@ -0,0 +1,168 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the outbound queue.
+ **/
+
+#include "RTMPOutbound.hpp"
+
+#include <cstring>
+
+namespace RTMP
+{
+    OutboundQueue::~OutboundQueue()
+    {
+        for (Block& block : blocks)
+            delete[] block.data;
+        for (unsigned char* data : freeBlocks)
+            delete[] data;
+    }
+
+    void OutboundQueue::Append(const void* data, size_t length)
+    {
+        if (length == 0)
+            return;
+
+        // Too large for a block; held by the queue itself.
+        if (length > BlockSize)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            shared_ptr<vector<unsigned char>> copy = make_shared<vector<unsigned char>>(bytes, bytes + length);
+            const unsigned char* copied = copy->data();
+            AppendReference(copied, length, move(copy));
+            return;
+        }
+
+        if (blocks.empty() || BlockSize - blocks.back().used < length)
+        {
+            unsigned char* storage;
+            if (!freeBlocks.empty())
+            {
+                storage = freeBlocks.back();
+                freeBlocks.pop_back();
+            }
+            else
+            {
+                storage = new unsigned char[BlockSize];
+            }
+            blocks.push_back({ storage, 0, 0 });
+            lastSegmentCopied = false;
+        }
+
+        Block& block = blocks.back();
+        unsigned char* destination = block.data + block.used;
+        memcpy(destination, data, length);
+        block.used += length;
+        size += length;
+
+        // Follows the previous copy in the same block: extend its slice.
+        if (lastSegmentCopied)
+        {
+            segments.back().length += length;
+            return;
+        }
+
+        segments.push_back({ destination, length, nullptr });
+        block.lastSegment = appended++;
+        lastSegmentCopied = true;
+    }
+
+    void OutboundQueue::AppendReference(const void* data, size_t length, shared_ptr<const void> owner)
+    {
+        if (length == 0)
+            return;
+
+        segments.push_back({ static_cast<const unsigned char*>(data), length, move(owner) });
+        appended++;
+        size += length;
+        lastSegmentCopied = false;
+    }
+
+    size_t OutboundQueue::Gather(Slice* slices, size_t maximum) const
+    {
+        size_t count = 0;
+        size_t offset = headOffset;
+
+        for (const Segment& segment : segments)
+        {
+            if (count == maximum)
+                break;
+
+            slices[count].data = segment.data + offset;
+            slices[count].length = segment.length - offset;
+            count++;
+            offset = 0;
+        }
+        return count;
+    }
+
+    void OutboundQueue::Consume(size_t length)
+    {
+        size -= length;
+        written += length;
+
+        while (length > 0)
+        {
+            Segment& segment = segments.front();
+            size_t remaining = segment.length - headOffset;
+
+            if (length < remaining)
+            {
+                headOffset += length;
+                break;
+            }
+
+            length -= remaining;
+            headOffset = 0;
+            segments.pop_front();
+            consumed++;
+        }
+
+        if (segments.empty())
+            lastSegmentCopied = false;
+
+        RecycleBlocks();
+    }
+
+    void OutboundQueue::RecycleBlocks()
+    {
+        /**
+         * A block is free once every segment pointing in it was consumed.
+         * The last block keeps receiving copies unless the queue is empty.
+         **/
+        while (!blocks.empty())
+        {
+            Block& block = blocks.front();
+            bool last = blocks.size() == 1;
+
+            if (last && !segments.empty())
+                break;
+            if (!last && block.lastSegment >= consumed)
+                break;
+
+            if (last)
+            {
+                block.used = 0;
+                break;
+            }
+
+            if (freeBlocks.size() < MaximumFreeBlocks)
+                freeBlocks.push_back(block.data);
+            else
+                delete[] block.data;
+            blocks.pop_front();
+        }
+    }
+
+    void OutboundQueue::Clear()
+    {
+        segments.clear();
+        headOffset = 0;
+        written += size;
+        size = 0;
+        consumed = appended;
+        lastSegmentCopied = false;
+        RecycleBlocks();
+    }
+}
@@ -0,0 +1,128 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Per-session outbound queue.
+ **/
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Contiguous bytes to write.
+     **/
+    struct Slice
+    {
+        const unsigned char* data = nullptr;
+        size_t length = 0;
+    };
+
+    /**
+     * Bytes waiting to be written to a session's socket, in order.
+     *
+     * Small fragments such as chunk headers are copied into fixed-size
+     * blocks, and consecutive copies are coalesced into one slice. Payloads
+     * are referenced in place and kept alive by their owner until written.
+     * The transport drains the queue with one gathered write per loop turn.
+     *
+     * Slices returned by Gather() stay valid until they are consumed, even
+     * when more data is queued meanwhile.
+     **/
+    class OutboundQueue
+    {
+        private:
+            struct Segment
+            {
+                const unsigned char* data;
+                size_t length;
+                shared_ptr<const void> owner;
+            };
+
+            struct Block
+            {
+                unsigned char* data;
+                size_t used;
+
+                // Sequence number of the last segment pointing in the block.
+                uint64_t lastSegment;
+            };
+
+            static constexpr size_t BlockSize = 4096;
+            static constexpr size_t MaximumFreeBlocks = 4;
+
+            deque<Segment> segments;
+
+            // Bytes of the first segment already written.
+            size_t headOffset = 0;
+            size_t size = 0;
+
+            // Bytes written (or cleared) since the queue was created.
+            uint64_t written = 0;
+
+            // Sequence numbers of the segments appended and consumed so far.
+            uint64_t appended = 0;
+            uint64_t consumed = 0;
+
+            // Blocks holding copied bytes, oldest first.
+            deque<Block> blocks;
+            vector<unsigned char*> freeBlocks;
+
+            // Whether the last segment ends where the last block is filled up to.
+            bool lastSegmentCopied = false;
+
+            void RecycleBlocks();
+
+        public:
+            OutboundQueue() {};
+            ~OutboundQueue();
+
+            OutboundQueue(const OutboundQueue&) = delete;
+            OutboundQueue& operator=(const OutboundQueue&) = delete;
+
+            /**
+             * Queued bytes.
+             **/
+            size_t Size() const { return size; }
+            bool Empty() const { return size == 0; }
+
+            /**
+             * Stream offsets: bytes written since the queue was created, and
+             * bytes queued since then. A byte queued at offset Queued() is
+             * written once Written() goes past it.
+             **/
+            uint64_t Written() const { return written; }
+            uint64_t Queued() const { return written + size; }
+
+            /**
+             * Queue a copy of `length` bytes.
+             **/
+            void Append(const void* data, size_t length);
+
+            /**
+             * Queue `length` bytes in place. `owner` keeps them alive until
+             * they are written.
+             **/
+            void AppendReference(const void* data, size_t length, shared_ptr<const void> owner);
+
+            /**
+             * Fill up to `maximum` slices from the front of the queue.
+             * Returns the number of slices filled.
+             **/
+            size_t Gather(Slice* slices, size_t maximum) const;
+
+            /**
+             * Release `length` written bytes from the front of the queue.
+             **/
+            void Consume(size_t length);
+
+            void Clear();
+    };
+}
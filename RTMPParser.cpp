@@ -22,138 +22,157 @@ namespace RTMP {
     /**
      * Version: 1 byte
      **/
-    void Parser::ParseHandshakeF0(vector<unsigned char>& data, Handshake::Handshake& handshake)
+    void Parser::ParseHandshakeF0(const BufferView& data, Handshake::Handshake& handshake)
     {
-        Utils::FormatedPrint::PrintFormated(
+        RTMP_TRACE(Debug, Handshake,
             "Parser::ParseHandshakeF0", 
             "Parsing F0.");
-        handshake.C0.version = (unsigned short int) data.at(0);        
+        handshake.C0.version = data.first[0];
     }
 
     /**
      * Time: 4 bytes.
      * Zeros: 4 bytes.
      * Random bytes: 1528 bytes.
+     * 
+     * S2 echoes C1; it is stored there directly.
      **/
-    void Parser::ParseHandshakeF1(vector<unsigned char>& data, Handshake::Handshake& handshake)
+    void Parser::ParseHandshakeF1(const BufferView& data, Handshake::Handshake& handshake)
     {
-        Utils::FormatedPrint::PrintFormated(
+        RTMP_TRACE(Debug, Handshake,
             "Parser::ParseHandshakeF1", 
             "Parsing F1.");
 
-        // Time
-        for (int i = 0; i < TIME_BYTES_COUNT + 1; i++)
-            handshake.C1.time[i] = data.at(i + 1);
-
-        // Random bytes
-        for (int i = 0; i < RANDOM_BYTES_COUNT; i++)
-            handshake.C1.randomBytes[i] = data.at(i + 5);
+        data.CopyTo(reinterpret_cast<unsigned char*>(&handshake.S2));
     }
 
     /**
      * Time: 4 bytes.
      * Time2: 4 bytes.
      * Random bytes: 1528 bytes.
+     * 
+     * C2 should echo the random bytes of S1.
      **/
-    void Parser::ParseHandshakeF2(vector<unsigned char>& data, Handshake::Handshake& handshake)
+    bool Parser::VerifyHandshakeF2(const BufferView& data, const Handshake::Handshake& handshake)
     {
-        Utils::FormatedPrint::PrintFormated(
-            "Parser::ParseHandshakeF2", 
-            "Parsing F2.");
-
-        for (int i = 0; i < TIME_BYTES_COUNT; i++) 
-            handshake.C2.time[i] = data.at(i);
-        for (int i = 0; i < TIME_BYTES_COUNT; i++)
-            handshake.C2.time2[i] = data.at(i + TIME_BYTES_COUNT);
-        for (int i = 0; i < RANDOM_BYTES_COUNT; i++)
-            handshake.C2.randomBytes[i] = data.at(i + (2*TIME_BYTES_COUNT));
+        RTMP_TRACE(Debug, Handshake,
+            "Parser::VerifyHandshakeF2", 
+            "Verifying F2.");
+
+        return data.Equals(handshake.S1.randomBytes);
     }
 
-    int Parser::ParseData(vector<unsigned char>& data, Session& session)
+    /**
+     * Hanshake state: 
+     *  - Uninitialized: 
+     *      - C0 & C1 not received, S0, S1 & S2 not sent.
+     *  - Version sent: 
+     *      - C0 & C1 received, S0, S1 & S2 being sent.
+     *  - Ack sent: 
+     *      - S0, S1 & S2 sent, C2 not received.
+     *  - Done: 
+     *      - C2 received.
+     * 
+     * Progress only depends on the number of buffered bytes, so C0, C1
+     * and C2 may be split across reads or arrive in a single one. Bytes
+     * following C2 stay in the receive buffer for the chunk parser.
+     **/
+    int Parser::ParseHandshake(Session& session)
     {
         int status = 0;
-        int size = data.size();
-        Handshake::Handshake& handshake = session.handshake;
+        RingBuffer& buffer = session.receiveBuffer;
 
-        /**
-         * Hanshake state: 
-         *  - Uninitialized: 
-         *      - F0 & F1 not sent.
-         *  - Version sent: 
-         *      - F0 & F1 sent, but not F2.
-         *      - F0 & F1 not received.
-         *  - Ack sent: 
-         *      - F2 sent.
-         *      - F0 & F1 received, but not F2.
-         *  - Done: 
-         *      - F2 received.
-         **/
-        Utils::FormatedPrint::PrintBytes<unsigned char>(data.data(), data.size());
-        switch (handshake.state)
+        if (session.handshakeState == Handshake::State::Uninitialized)
         {
-            case Handshake::State::Uninitialized:
+            if (buffer.Size() < 1 + HANDSHAKE_PACKET_SIZE)
             {
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseData", 
-                    "Parsing C0 & C1.");
+                session.pendingBytes = 1 + HANDSHAKE_PACKET_SIZE;
+                return status;
+            }
 
+            RTMP_TRACE(Debug, Handshake,
+                "Parser::ParseHandshake", 
+                "Parsing C0 & C1.");
 
-                // Parse C0 & C1.
-                Parser::ParseHandshakeF0(data, handshake);
-                Parser::ParseHandshakeF1(data, handshake);
+            session.handshake.reset(new Handshake::Handshake);
+            Handshake::Handshake& handshake = *session.handshake;
 
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseData", 
-                    "RTMP Version: " + to_string(handshake.C0.version) + ".");
+            // Parse C0 & C1.
+            Parser::ParseHandshakeF0(buffer.Peek(0, 1), handshake);
+            Parser::ParseHandshakeF1(buffer.Peek(1, HANDSHAKE_PACKET_SIZE), handshake);
+            buffer.Consume(1 + HANDSHAKE_PACKET_SIZE);
 
-                // Send S0 & S1 & S2.
-                #ifdef LIVE
-                status = Handler::SendHandshake(session);
-                #endif
+            RTMP_TRACE(Debug, Handshake,
+                "Parser::ParseHandshake", 
+                "RTMP Version: {}.",
+                handshake.C0.version);
 
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseData", 
-                    "Version Sent.");
+            // Send S0 & S1 & S2.
+            session.handshakeState = Handshake::State::VersionSent;
+            #ifdef LIVE
+            status = Handler::SendHandshake(session);
+            #endif
 
-                handshake.state = Handshake::State::VersionSent;
-            };
-            case Handshake::State::VersionSent:
-            {
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseData", 
-                    "Acknowledge sent.");
+            RTMP_TRACE(Debug, Handshake,
+                "Parser::ParseHandshake", 
+                "Acknowledge sent.");
 
-                handshake.state = Handshake::State::AcknowledgeSent;
-                break;
-            };
+            session.handshakeState = Handshake::State::AcknowledgeSent;
+        }
 
-            case Handshake::State::AcknowledgeSent:
+        if (session.handshakeState == Handshake::State::AcknowledgeSent)
+        {
+            if (buffer.Size() < HANDSHAKE_PACKET_SIZE)
             {
-                // Parse C2.
-                Parser::ParseHandshakeF2(data, handshake);
+                session.pendingBytes = HANDSHAKE_PACKET_SIZE;
+                return status;
+            }
 
-                // Dont reply to C2.
-                status = -2;
+            // Verify C2.
+            if (!Parser::VerifyHandshakeF2(buffer.Peek(2 * TIME_BYTES_COUNT, RANDOM_BYTES_COUNT), *session.handshake))
+                RTMP_TRACE(Warning, Handshake,
+                    "Parser::ParseHandshake", 
+                    "C2 does not echo S1.");
+            buffer.Consume(HANDSHAKE_PACKET_SIZE);
 
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseData", 
-                    "Handshake done.");
+            RTMP_TRACE(Debug, Handshake,
+                "Parser::ParseHandshake", 
+                "Handshake done.");
 
-                handshake.state = Handshake::State::Done;
-                break;
-            };
+            // Handshake data is no longer needed.
+            session.handshake.reset();
+            session.handshakeState = Handshake::State::Done;
+        }
 
-            case Handshake::State::Done:
-            {
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseData", 
-                    "Handshake done. Processing chunk.");
+        return status;
+    }
 
-                // Chunk parsing.
-                return ParseChunks(data, session);
-                break;
-            };
-        };
+    int Parser::ParseData(vector<unsigned char>& data, Session& session)
+    {
+        RTMP_TRACE_BYTES(Parser, data.data(), data.size());
+
+        session.receiveBuffer.Write(data.data(), data.size());
+        return ParseBuffered(session);
+    }
+
+    int Parser::ParseBuffered(Session& session)
+    {
+        int status = 0;
+
+        // Not enough data to make progress since the last attempt.
+        if (session.receiveBuffer.Size() < session.pendingBytes)
+            return status;
+        session.pendingBytes = 0;
+
+        if (session.handshakeState != Handshake::State::Done)
+            status += ParseHandshake(session);
+
+        // Chunks may follow C2 in the same read.
+        if (session.handshakeState == Handshake::State::Done)
+            status += ParseChunks(session);
+
+        // Trace records are formatted once per read, not per message.
+        Trace::Flush();
         return status;
     }
 
@@ -162,255 +181,351 @@ namespace RTMP {
      * Chunk Parsing.
      **/
 
-    void Parser::ParseChunkBasicHeader(vector<unsigned char>& data, Chunk& chunk)
+    /**
+     * Message header size in bytes, indexed by chunk format.
+     **/
+    static const size_t MessageHeaderSize[4] = { 11, 7, 3, 0 };
+
+    /**
+     * Message header decoders, indexed by chunk format.
+     * The caller has checked that the header bytes are available.
+     **/
+    typedef void (*MessageHeaderDecoder)(const unsigned char* data, ChunkHeader::MessageHeader& header);
+
+    static void DecodeMessageHeaderType0(const unsigned char* data, ChunkHeader::MessageHeader& header)
+    {
+        // 11-byte message header.
+        header.timestamp_delta = Endian::Load24BE(data);
+        header.message_length = Endian::Load24BE(data + 3);
+        header.message_type_id = data[6];
+        header.message_stream_id = Endian::Load32LE(data + 7);
+    }
+
+    static void DecodeMessageHeaderType1(const unsigned char* data, ChunkHeader::MessageHeader& header)
+    {
+        // 7-byte message header.
+        header.timestamp_delta = Endian::Load24BE(data);
+        header.message_length = Endian::Load24BE(data + 3);
+        header.message_type_id = data[6];
+    }
+
+    static void DecodeMessageHeaderType2(const unsigned char* data, ChunkHeader::MessageHeader& header)
     {
-        // Utils::FormatedPrint::PrintBytes(data.data(), data.size());
-        // Byte 0
-        unsigned int bZero = (unsigned) data.at(0);
-
-        // format
-        unsigned int fmt = (unsigned) bZero >> 6;
-        Utils::FormatedPrint::PrintFormated(
-            "Parser::ParseChunkBasicHeader", 
-            "Format value is: " + to_string(fmt) + ".");
-
-        // chunk stream id
-        unsigned int csid = (unsigned) bZero & 0x3F;
+        // 3-byte message header.
+        header.timestamp_delta = Endian::Load24BE(data);
+    }
+
+    static void DecodeMessageHeaderType3(const unsigned char*, ChunkHeader::MessageHeader&)
+    {
+        // No message header.
+    }
+
+    static const MessageHeaderDecoder MessageHeaderDecoders[4] = {
+        DecodeMessageHeaderType0,
+        DecodeMessageHeaderType1,
+        DecodeMessageHeaderType2,
+        DecodeMessageHeaderType3
+    };
+
+    DecodeResult Parser::DecodeChunkHeader(const unsigned char* data, size_t available, ChunkStreamTable& chunkStreams, Chunk& chunk, const ChunkStreamState*& state)
+    {
+        unsigned int bZero = data[0];
+        unsigned int fmt = bZero >> 6;
+        unsigned int csid = bZero & 0x3F;
+
         chunk.basicHeader.baseID = 2;
+        chunk.basicHeader.fmt = fmt;
 
-        // If the chunk stream id is of 0 or 1,
-        // it's a 2 or 3 bytes header field.
-        if (csid == 0) 
+        /**
+         * Fast path: 1-byte Type 3 header, continuing a message or repeating
+         * the previous one. Everything comes from the chunk stream state.
+         **/
+        if (fmt == ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3 && csid >= 2)
         {
-            csid = data.at(1) + 64;
-            chunk.displacement += 1;
+            state = chunkStreams.Find(csid);
+            if (state == nullptr)
+                return { DecodeResult::Status::ProtocolError, 1 };
+
+            chunk.basicHeader.csid = csid;
+            chunk.displacement = 1;
+            if (state->extendedTimestamp)
+            {
+                if (available < 5)
+                    return { DecodeResult::Status::NeedMoreData, 5 };
+                chunk.hasExtendedTimestamp = true;
+                chunk.extendedTimestamp = Endian::Load32BE(data + 1);
+                chunk.displacement = 5;
+            }
+            return { DecodeResult::Status::Ok, (size_t)chunk.displacement };
         }
-        else if (csid == 1) 
+
+        /**
+         * Header size is known from the first byte, except for the
+         * extended timestamp which depends on the timestamp field.
+         **/
+        size_t basicHeaderLength = 1 + (csid == 0) + 2 * (csid == 1);
+        size_t length = basicHeaderLength + MessageHeaderSize[fmt];
+        if (available < length)
+            return { DecodeResult::Status::NeedMoreData, length };
+
+        // 2 or 3 bytes basic header.
+        if (csid == 0)
+            csid = data[1] + 64;
+        else if (csid == 1)
+            csid = data[1] + data[2] * 256 + 64;
+        chunk.basicHeader.csid = csid;
+
+        MessageHeaderDecoders[fmt](data + basicHeaderLength, chunk.messageHeader);
+
+        state = chunkStreams.Find(csid);
+        if (state == nullptr && fmt != ChunkHeader::MessageHeader::ChunkHeaderFormat::Type0)
+            return { DecodeResult::Status::ProtocolError, length };
+
+        // Type 3 chunks carry one when the chunk stream's last header did.
+        chunk.hasExtendedTimestamp = fmt == ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3
+            ? state->extendedTimestamp
+            : chunk.messageHeader.timestamp_delta == 0xFFFFFF;
+
+        if (chunk.hasExtendedTimestamp)
         {
-            csid = ((data.at(2))*256 + (data.at(1) + 64));
-            chunk.displacement += 2;
+            if (available < length + 4)
+                return { DecodeResult::Status::NeedMoreData, length + 4 };
+
+            // The extended timestamp replaces the 24-bit field.
+            chunk.extendedTimestamp = Endian::Load32BE(data + length);
+            if (fmt != ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3)
+                chunk.messageHeader.timestamp_delta = chunk.extendedTimestamp;
+            length += 4;
         }
 
-        Utils::FormatedPrint::PrintFormated(
-            "Parser::ParseChunkBasicHeader", 
-            "Chunk stream ID: " + to_string(csid) + ".");
-
-        // Assignations
-        chunk.basicHeader.csid = csid;
-        chunk.basicHeader.fmt = fmt;
-        chunk.displacement += 1;
+        chunk.displacement = length;
+        return { DecodeResult::Status::Ok, length };
     }
 
-    void Parser::ParseChunkMessageHeader(vector<unsigned char>& data, Chunk& chunk)
+    /**
+     * Fill the fields omitted by Type 1, 2 and 3 headers from the previous
+     * header of the same chunk stream, and compute the absolute timestamp.
+     * The chunk stream state itself is left untouched.
+     **/
+    void Parser::InheritChunkHeader(Chunk& chunk, const ChunkStreamState* state)
     {
-        int fmt = chunk.basicHeader.fmt;
-        unsigned char   bTimestamp[3], 
-                        bMessageLength[3], 
-                        bMessageStreamID[4]; 
-        switch (fmt)
+        ChunkHeader::MessageHeader& header = chunk.messageHeader;
+
+        switch (chunk.basicHeader.fmt)
         {
             case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type0:
             {
-                // 11-byte message header.
-                for (int i = 0; i < 3; i++) //  3 bytes
-                {
-                    bTimestamp[i] = data.at(i + chunk.displacement);
-                    bMessageLength[i] = data.at(i + chunk.displacement + 3);
-                }
-                for (int i = 0; i < 4; i++) //  4 bytes
-                    bMessageStreamID[i] = data.at(i + 7 + chunk.displacement);
-
-                // Message type id -            1 byte
-                chunk.messageHeader.message_type_id = data.at(6 + chunk.displacement);
-                // Timestamp delta
-                Utils::BitOperations::bytesToInteger<int>(
-                    chunk.messageHeader.timestamp_delta,
-                    bTimestamp,
-                    false,
-                    3);
-                // Message length
-                Utils::BitOperations::bytesToInteger<int>(
-                    chunk.messageHeader.message_length, 
-                    bMessageLength, 
-                    false,
-                    3);
-                // Message stream id
-                Utils::BitOperations::bytesToInteger<int>(
-                    chunk.messageHeader.message_stream_id, 
-                    bMessageStreamID,
-                    true,
-                    4);
-                chunk.displacement += 11;
-
+                // Absolute timestamp.
+                chunk.timestamp = header.timestamp_delta;
                 break;
             };
-                
             case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type1:
             {
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParserChunkMessageHeader",
-                    "Parsing message header format 1.");
-                // 7-byte message header.
-                for (int i = 0; i < 3; i++)
-                {
-                    bTimestamp[i] = data.at(i + chunk.displacement);
-                    bMessageLength[i] = data.at(i + chunk.displacement + 3);
-                }
-                // Timestamp delta
-                Utils::BitOperations::bytesToInteger<int>(
-                    chunk.messageHeader.timestamp_delta,
-                    bTimestamp,
-                    false,
-                    3);
-                // Message length
-                Utils::BitOperations::bytesToInteger<int>(
-                    chunk.messageHeader.message_length, 
-                    bMessageLength, 
-                    false,
-                    3);
-                // Message type id
-                chunk.messageHeader.message_type_id = data.at(6 + chunk.displacement);
-                chunk.displacement += 7;
+                header.message_stream_id = state->header.message_stream_id;
+                chunk.timestamp = state->timestamp + header.timestamp_delta;
                 break;
             };
-
             case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type2:
             {
-                // 3-byte message header.
-                chunk.displacement += 3;
-                for (int i = 0; i < 3; i++)
-                    bTimestamp[i] = data.at(i + chunk.displacement);
-                Utils::BitOperations::bytesToInteger<int>(
-                    chunk.messageHeader.timestamp_delta,
-                    bTimestamp,
-                    false,
-                    3);
+                header.message_length = state->header.message_length;
+                header.message_type_id = state->header.message_type_id;
+                header.message_stream_id = state->header.message_stream_id;
+                chunk.timestamp = state->timestamp + header.timestamp_delta;
                 break;
             };
-
             case ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3:
             {
-                // No message header.
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseChunkMessageHeader", 
-                    "Type3 header format: No message header.");
-                break;
-            };
+                header = state->header;
 
-            default:
-                // Error
-                Utils::FormatedPrint::PrintFormated(
-                    "Parser::ParseChunkMessageHeader", 
-                    "Error: No message header type matching.");
+                // Continuing a message keeps its timestamp.
+                chunk.timestamp = state->timestamp;
+                if (state->message == nullptr)
+                    chunk.timestamp += header.timestamp_delta;
                 break;
-        };
+            };
+        }
     }
 
-    void Parser::ParseChunkExtendedTimestamp(vector<unsigned char>& data, Chunk& chunk)
+    int Parser::DispatchMessage(Chunk& chunk, Session& session)
     {
-        if (!(chunk.messageHeader.timestamp_delta == 0xFFFFFF)) 
-            return;
-        unsigned char bExtendedTimestamp[4];
-        for (int i = 0; i < 4; i++)
-            bExtendedTimestamp[i] = data.at(i + chunk.displacement);
-        
-        Utils::BitOperations::bytesToInteger(
-            chunk.extendedTimestamp,
-            bExtendedTimestamp,
-            false,
-            4); 
-
-        Utils::FormatedPrint::PrintFormated(
-            "Parser::ParseChunkExtendedTimestamp", 
-            "Extended Timestamp: " + to_string(chunk.extendedTimestamp) + ".");
-
-        chunk.displacement += 4;
+        RTMP_TRACE(Debug, Parser,
+            "Parser::DispatchMessage",
+            "Message type ID: {}, length: {}, stream ID: {}, timestamp: {}.",
+            chunk.messageHeader.message_type_id,
+            chunk.messageHeader.message_length,
+            chunk.messageHeader.message_stream_id,
+            chunk.timestamp);
+
+        session.lastChunk = &chunk;
+        int status = Handler::HandleChunk(chunk, session);
+
+        // The chunk only lives for the dispatch.
+        session.lastChunk = nullptr;
+        return status;
     }
 
-    void Parser::ParseChunkData(vector<unsigned char>& data, Chunk& chunk) 
+    size_t Parser::MaximumBuffered(const Session& session)
     {
-        int size = chunk.messageHeader.message_length;
-        Utils::FormatedPrint::PrintFormated(
-            "Parser::ParseChunkData", 
-            "Payload/chunk size: " + to_string(size) + ".");
+        // Message lengths are 24 bits: no chunk carries more, whatever the chunk size.
+        size_t chunkSize = session.inChunkSize < 0xFFFFFF ? session.inChunkSize : 0xFFFFFF;
+        size_t largest = chunkSize + MAX_CHUNK_HEADER_SIZE;
 
-        unsigned char* bData = new unsigned char[size];
-        for (int i = 0; i < size; i++)
-        {
-            bData[i] = (unsigned)data.at(i);
-            printf("\n@%i", (unsigned)data.at(i));
-        }
-        
-        chunk.data = bData;
+        // C0, C1 and C2 may arrive together.
+        return largest > Handshake::ResponseSize ? largest : Handshake::ResponseSize;
     }
 
-    int Parser::ParseChunks(vector<unsigned char>& data, Session& session)
+    int Parser::ParseChunks(Session& session)
     {
         int status = 0;
+        RingBuffer& buffer = session.receiveBuffer;
 
-        // Get remaining data from last buffer.
-        data.insert(data.begin(), session.remainingBytes.begin(), session.remainingBytes.end());
-        
-        int size = data.size();
+        // Not enough data to make progress since the last attempt.
+        if (buffer.Size() < session.pendingBytes)
+            return status;
+        session.pendingBytes = 0;
 
-        int index = 0;
+        while (!buffer.Empty())
+        {
+            size_t available = buffer.Size();
 
-        bool forceQuit = false;
+            /**
+             * Headers are decoded in place when contiguous in the ring buffer,
+             * and linearized first when they wrap around its end.
+             **/
+            unsigned char scratch[MAX_CHUNK_HEADER_SIZE];
+            size_t headerBytes = available < MAX_CHUNK_HEADER_SIZE ? available : MAX_CHUNK_HEADER_SIZE;
+            BufferView headerView = buffer.Peek(0, headerBytes);
+            const unsigned char* header = headerView.first;
+            if (!headerView.Contiguous())
+            {
+                headerView.CopyTo(scratch);
+                header = scratch;
+            }
 
-        while (index + 1 < size || forceQuit)
-        {
             Chunk chunk;
-            session.lastChunk = &chunk;
-            Utils::FormatedPrint::PrintFormated(
-                "Parser::ParseChunks",
-                "Index: " + to_string(index)
-            );
-            vector<unsigned char> remainingChunkData(data.begin() + index, data.end());
-            Utils::FormatedPrint::PrintFormated(
-                "Parser::ParseChunks",
-                "Remaining chunk data:");
-            Utils::FormatedPrint::PrintBytes<unsigned char>(remainingChunkData.data(), remainingChunkData.size());
-
-            ParseChunkBasicHeader(remainingChunkData, chunk);
-            ParseChunkMessageHeader(remainingChunkData, chunk);
-            ParseChunkExtendedTimestamp(remainingChunkData, chunk);
-
-            if (chunk.displacement + chunk.messageHeader.message_length > remainingChunkData.size()) 
+            const ChunkStreamState* state = nullptr;
+            DecodeResult result = DecodeChunkHeader(header, headerBytes, session.chunkStreams, chunk, state);
+
+            if (result.status == DecodeResult::Status::NeedMoreData)
+            {
+                session.pendingBytes = result.length;
+                break;
+            }
+            if (result.status == DecodeResult::Status::ProtocolError)
+            {
+                RTMP_TRACE(Error, Parser,
+                    "Parser::ParseChunks", 
+                    "Compressed chunk header on unknown chunk stream {}.",
+                    chunk.basicHeader.csid);
+                session.closing = true;
+                return -1;
+            }
+            InheritChunkHeader(chunk, state);
+
+            /**
+             * Messages are split in chunks of at most the inbound chunk size.
+             * A message in progress on the chunk stream is continued by Type 3
+             * chunks; any other header starts a new message.
+             **/
+            MessageBuffer* message = state != nullptr ? state->message : nullptr;
+            bool continuation = message != nullptr
+                && chunk.basicHeader.fmt == ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3;
+
+            size_t messageLength = chunk.messageHeader.message_length;
+            size_t length = messageLength - (continuation ? message->length : 0);
+            if (length > session.inChunkSize)
+                length = session.inChunkSize;
+
+            size_t chunkLength = chunk.displacement + length;
+            if (available < chunkLength)
             {
-                session.lastChunk = &chunk;
-                session.remainingBytes.insert(
-                    session.remainingBytes.end(), 
-                    remainingChunkData.begin(), 
-                    remainingChunkData.end());
-                forceQuit = true;
+                // Make sure the whole chunk fits before asking for more data.
+                session.pendingBytes = chunkLength;
+                buffer.Reserve(chunkLength);
                 break;
             }
 
+            // The chunk is complete; a new message becomes the chunk stream's reference header.
+            ChunkStreamState& stream = session.chunkStreams.Get(chunk.basicHeader.csid);
+            if (!continuation)
+            {
+                if (stream.message != nullptr)
+                {
+                    RTMP_TRACE(Error, Parser,
+                        "Parser::ParseChunks", 
+                        "Message interrupted on chunk stream {}.",
+                        chunk.basicHeader.csid);
+                    session.partialBytes -= stream.message->capacity;
+                    stream.message->pool->Release(stream.message);
+                    stream.message = nullptr;
+                }
+                stream.header = chunk.messageHeader;
+                stream.timestamp = chunk.timestamp;
+                stream.extendedTimestamp = chunk.hasExtendedTimestamp;
+            }
+
+            BufferView body = buffer.Peek(chunk.displacement, length);
+
             /**
-             * Parse chunk body. 
+             * Single chunk message: the body is handed out in place when it is
+             * contiguous in the ring buffer, and only copied when it wraps.
              */
-            vector<unsigned char> chunkData(
-                remainingChunkData.begin() + chunk.displacement, 
-                remainingChunkData.begin() + chunk.displacement + chunk.messageHeader.message_length);
-            ParseChunkData(chunkData, chunk);
+            if (!continuation && length == messageLength)
+            {
+                if (body.Contiguous())
+                {
+                    chunk.data = body.first;
+                }
+                else
+                {
+                    if (session.payloadScratch.size() < length)
+                        session.payloadScratch.resize(length);
+                    body.CopyTo(session.payloadScratch.data());
+                    chunk.data = session.payloadScratch.data();
+                }
+
+                status += DispatchMessage(chunk, session);
+                buffer.Consume(chunkLength);
+                continue;
+            }
 
-            Utils::FormatedPrint::PrintFormated(
+            /**
+             * Multi-chunk message: reassembled in a pooled buffer sized from
+             * the message length announced by its first chunk. The length is
+             * the peer's to pick, so what every chunk stream reserves at once
+             * is bounded.
+             */
+            if (!continuation)
+            {
+                if (session.partialBytes + messageLength > Session::MaximumPartialBytes)
+                {
+                    RTMP_TRACE(Error, Parser,
                         "Parser::ParseChunks", 
-                        "Message header:");
-            #if __DEBUG
-            printf("\nMessage timestamp delta: %i", chunk.messageHeader.timestamp_delta);
-            printf("\nMessage type ID: %i", chunk.messageHeader.message_type_id);
-            printf("\nMessage length : %i", chunk.messageHeader.message_length);
-            if (chunk.basicHeader.fmt == ChunkHeader::MessageHeader::ChunkHeaderFormat::Type0)
-                printf("\nMessage stream ID: %i", chunk.messageHeader.message_stream_id);
-            #endif
+                        "Too many bytes reserved for messages in progress, {} more on chunk stream {}.",
+                        messageLength, chunk.basicHeader.csid);
+                    session.closing = true;
+                    return -1;
+                }
+                stream.message = session.bufferPool->Acquire(messageLength);
+                session.partialBytes += stream.message->capacity;
+            }
+
+            message = stream.message;
+            body.CopyTo(message->Data() + message->length);
+            message->length += length;
+            buffer.Consume(chunkLength);
 
-            index += chunk.displacement + chunk.messageHeader.message_length;
+            if (message->length < messageLength)
+                continue;
 
-            status += Handler::HandleChunk(chunk, session);
+            stream.message = nullptr;
+            session.partialBytes -= message->capacity;
+            chunk.data = message->Data();
+            status += DispatchMessage(chunk, session);
+            message->pool->Release(message);
         }
 
         return status;
 
     }
-}
\ No newline at end of file
+}
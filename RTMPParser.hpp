@@ -10,17 +10,38 @@
 #include "RTMPHandshake.hpp"
 #include "RTMPMessage.hpp"
 #include "RTMPChunk.hpp"
+#include "RTMPChunkStream.hpp"
+#include "RTMPTrace.hpp"
+#include "RTMPEndian.hpp"
 
-#include <utils/Bit.hpp>
-#include <utils/FormatedPrint.hpp>
 #include <utils/amf0.hpp>
 
 #include <iostream>
+#include <cstring>
 #include <vector>
 using namespace std;
 
 namespace RTMP
 {
+    /**
+     * Outcome of decoding a chunk header.
+     *  - Ok: the header is `length` bytes long.
+     *  - NeedMoreData: at least `length` bytes are needed to decode it.
+     *  - ProtocolError: the header is invalid, the connection should be closed.
+     **/
+    struct DecodeResult
+    {
+        enum class Status
+        {
+            Ok,
+            NeedMoreData,
+            ProtocolError
+        };
+
+        Status status;
+        size_t length;
+    };
+
     class Parser
     {
         private:
@@ -28,17 +49,22 @@ namespace RTMP
             /** 
              * Handshake parsing.
              **/
-            static void ParseHandshakeF0(vector<unsigned char>& data, Handshake::Handshake& handshake);
-            static void ParseHandshakeF1(vector<unsigned char>& data, Handshake::Handshake& handshake);
-            static void ParseHandshakeF2(vector<unsigned char>& data, Handshake::Handshake& handshake);
+            static void ParseHandshakeF0(const BufferView& data, Handshake::Handshake& handshake);
+            static void ParseHandshakeF1(const BufferView& data, Handshake::Handshake& handshake);
+            static bool VerifyHandshakeF2(const BufferView& data, const Handshake::Handshake& handshake);
+            static int ParseHandshake(Session& session);
             
             /**
              * Chunk parsing.
              **/
-            static void ParseChunkBasicHeader(vector<unsigned char>& data, Chunk& chunk);
-            static void ParseChunkMessageHeader(vector<unsigned char>& data, Chunk& chunk);
-            static void ParseChunkExtendedTimestamp(vector<unsigned char>& data, Chunk& chunk);
-            static void ParseChunkData(vector<unsigned char>& data, Chunk& chunk);
+            static DecodeResult DecodeChunkHeader(
+                const unsigned char* data, 
+                size_t available, 
+                ChunkStreamTable& chunkStreams, 
+                Chunk& chunk, 
+                const ChunkStreamState*& state);
+            static void InheritChunkHeader(Chunk& chunk, const ChunkStreamState* state);
+            static int DispatchMessage(Chunk& chunk, Session& session);
 
             /**
              * Command parsing.
@@ -52,7 +78,27 @@ namespace RTMP
 
         public:
             static int ParseData(vector<unsigned char>& data, Session& session);
+
+            /**
+             * Parse what is buffered in the session's receive buffer: the
+             * handshake, whatever way its packets were split or coalesced,
+             * then the chunks that follow it.
+             **/
+            static int ParseBuffered(Session& session);
             // static int ParseChunk(vector<unsigned char>& data, Session& session);
-            static int ParseChunks(vector<unsigned char>& data, Session& session);
+
+            /**
+             * Parse the chunks buffered in the session's receive buffer.
+             * Stops at the first incomplete chunk and records in
+             * session.pendingBytes how many bytes are needed to resume.
+             **/
+            static int ParseChunks(Session& session);
+
+            /**
+             * Most the receive buffer has to hold for the parser to make
+             * progress: the handshake, or the largest chunk at the inbound
+             * chunk size. Transports close the session past it.
+             **/
+            static size_t MaximumBuffered(const Session& session);
     };
 }
\ No newline at end of file
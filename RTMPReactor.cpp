@@ -0,0 +1,350 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the epoll event loop.
+ **/
+
+#include "RTMPReactor.hpp"
+#include "RTMPParser.hpp"
+#include "RTMPHandler.hpp"
+
+#include <cerrno>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+namespace RTMP
+{
+    /**
+     * Events of the listening and wake descriptors carry these
+     * addresses; events of sessions carry the session.
+     **/
+    static char ListenTag;
+    static char WakeTag;
+
+    static constexpr int MaximumEvents = 256;
+
+    // Slices written by one sendmsg.
+    static constexpr size_t MaximumSlices = 64;
+
+    Reactor::Reactor()
+    {
+        epollDescriptor = epoll_create1(EPOLL_CLOEXEC);
+        wakeDescriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = &WakeTag;
+        epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, wakeDescriptor, &event);
+    }
+
+    Reactor::~Reactor()
+    {
+        for (Session* session : sessions)
+        {
+            Handler::CloseSession(*session);
+            close(session->socket);
+            delete session;
+        }
+        sessions.clear();
+
+        if (listenDescriptor >= 0)
+            close(listenDescriptor);
+        close(wakeDescriptor);
+        close(epollDescriptor);
+    }
+
+    int Reactor::Listen(unsigned short port, int backlog)
+    {
+        listenDescriptor = OpenListenSocket(port, backlog, reusePort);
+        if (listenDescriptor < 0)
+            return -1;
+
+        epoll_event event = {};
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = &ListenTag;
+        return epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, listenDescriptor, &event);
+    }
+
+    int Reactor::Run()
+    {
+        epoll_event events[MaximumEvents];
+        int timeout = -1;
+
+        // Sessions acquire from the pool on this thread only.
+        bufferPool->BindToCurrentThread();
+
+        while (!stopping)
+        {
+            int count = epoll_wait(epollDescriptor, events, MaximumEvents, timeout);
+            if (count < 0)
+            {
+                if (errno == EINTR)
+                    continue;
+                return -1;
+            }
+
+            for (int i = 0; i < count; i++)
+            {
+                void* tag = events[i].data.ptr;
+                if (tag == &ListenTag)
+                {
+                    Accept();
+                    continue;
+                }
+                if (tag == &WakeTag)
+                {
+                    uint64_t value;
+                    while (read(wakeDescriptor, &value, sizeof(value)) > 0);
+                    continue;
+                }
+
+                Session* session = static_cast<Session*>(tag);
+                uint32_t flags = events[i].events;
+
+                if (flags & EPOLLIN)
+                    Read(*session);
+                if ((flags & EPOLLOUT) && !session->closing && Flush(*session) < 0)
+                    session->closing = true;
+                if (flags & (EPOLLERR | EPOLLHUP))
+                    session->closing = true;
+
+                if (session->closing)
+                    Close(session);
+            }
+
+            RunPosted();
+            timeout = RunTimers();
+            FlushScheduled();
+            Trace::Flush();
+        }
+
+        return 0;
+    }
+
+    void Reactor::Stop()
+    {
+        stopping = true;
+        Wake();
+    }
+
+    void Reactor::Wake()
+    {
+        uint64_t value = 1;
+        ssize_t written = write(wakeDescriptor, &value, sizeof(value));
+        (void)written;
+    }
+
+    void Reactor::Accept()
+    {
+        for (;;)
+        {
+            int descriptor = accept4(listenDescriptor, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (descriptor < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                // Every pending connection was accepted.
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    return;
+
+                int error = errno;
+                RTMP_TRACE(Error, Transport,
+                    "Reactor::Accept",
+                    "Accept failed, errno {}.",
+                    error);
+
+                /**
+                 * The listener is edge-triggered: connections left pending
+                 * would never be signaled again. Past the descriptor limit
+                 * they are refused; otherwise, accepting is retried later.
+                 **/
+                if ((error == EMFILE || error == ENFILE) && RefuseConnection(listenDescriptor))
+                    continue;
+
+                if (!acceptRetry)
+                {
+                    acceptRetry = true;
+                    After(AcceptRetryDelay, [this]() {
+                        acceptRetry = false;
+                        Accept();
+                    });
+                }
+                return;
+            }
+
+            int enable = 1;
+            setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            Session* session = new Session;
+            session->socket = descriptor;
+            session->transport = this;
+            session->bufferPool = bufferPool;
+
+            // Writability is watched from the start; with edge-triggering it
+            // only fires when a full socket buffer drains.
+            epoll_event event = {};
+            event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+            event.data.ptr = session;
+            if (epoll_ctl(epollDescriptor, EPOLL_CTL_ADD, descriptor, &event) < 0)
+            {
+                close(descriptor);
+                delete session;
+                continue;
+            }
+
+            sessions.insert(session);
+            sessionCount++;
+
+            RTMP_TRACE(Debug, Transport,
+                "Reactor::Accept",
+                "Session accepted on socket {}.",
+                descriptor);
+        }
+    }
+
+    void Reactor::Read(Session& session)
+    {
+        RingBuffer& buffer = session.receiveBuffer;
+
+        /**
+         * Edge-triggered: read until the socket is drained.
+         **/
+        for (;;)
+        {
+            size_t length = 0;
+            unsigned char* region = buffer.WritableRegion(length);
+            if (length == 0)
+            {
+                // Full: let the parser consume, grow if it needs more room.
+                Parser::ParseBuffered(session);
+                if (session.closing)
+                    break;
+                if (buffer.Available() == 0)
+                {
+                    // Nothing consumed from a buffer that holds the largest legal chunk.
+                    if (buffer.Capacity() >= Parser::MaximumBuffered(session))
+                    {
+                        RTMP_TRACE(Error, Transport,
+                            "Reactor::Read",
+                            "Chunk larger than {} bytes.",
+                            buffer.Capacity());
+                        session.closing = true;
+                        break;
+                    }
+                    buffer.Reserve(buffer.Capacity() * 2);
+                }
+                continue;
+            }
+
+            ssize_t received = recv(session.socket, region, length, 0);
+            if (received > 0)
+            {
+                buffer.Commit(received);
+                session.totalBytes += received;
+                continue;
+            }
+
+            if (received == 0)
+            {
+                // Peer closed the connection.
+                session.closing = true;
+                break;
+            }
+
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                session.closing = true;
+            break;
+        }
+
+        if (!buffer.Empty() && !session.closing)
+            Parser::ParseBuffered(session);
+    }
+
+    void Reactor::Close(Session* session)
+    {
+        RTMP_TRACE(Debug, Transport,
+            "Reactor::Close",
+            "Closing session on socket {}.",
+            session->socket);
+
+        Unschedule(*session);
+        Handler::CloseSession(*session);
+        epoll_ctl(epollDescriptor, EPOLL_CTL_DEL, session->socket, nullptr);
+        close(session->socket);
+
+        sessions.erase(session);
+        sessionCount--;
+        delete session;
+    }
+
+    void Reactor::FlushScheduled()
+    {
+        // Sessions may be closed, and nulled in the list, while it is walked.
+        for (size_t i = 0; i < scheduled.size(); i++)
+        {
+            Session* session = scheduled[i];
+            if (session == nullptr)
+                continue;
+
+            session->sendScheduled = false;
+
+            // Also closes sessions marked closing outside of their own events.
+            if (Flush(*session) < 0 || session->closing)
+            {
+                session->closing = true;
+                Close(session);
+            }
+        }
+        scheduled.clear();
+    }
+
+    int Reactor::Flush(Session& session)
+    {
+        OutboundQueue& queue = session.outbound;
+        Slice slices[MaximumSlices];
+        iovec vectors[MaximumSlices];
+
+        /**
+         * Until the queue is empty or the socket refuses more: with
+         * edge-triggering, EPOLLOUT only fires again after EAGAIN.
+         **/
+        while (!queue.Empty())
+        {
+            size_t count = queue.Gather(slices, MaximumSlices);
+            for (size_t i = 0; i < count; i++)
+            {
+                vectors[i].iov_base = const_cast<unsigned char*>(slices[i].data);
+                vectors[i].iov_len = slices[i].length;
+            }
+
+            msghdr message = {};
+            message.msg_iov = vectors;
+            message.msg_iovlen = count;
+
+            ssize_t result = sendmsg(session.socket, &message, MSG_NOSIGNAL);
+            if (result >= 0)
+            {
+                queue.Consume(result);
+
+                // Recorded streams are queued a window at a time.
+                if (queue.Empty())
+                    Handler::HandleDrained(session);
+                continue;
+            }
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 0;
+            return -1;
+        }
+        return 0;
+    }
+}
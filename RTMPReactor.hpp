@@ -0,0 +1,68 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Linux epoll event loop.
+ **/
+
+#include "RTMPTransport.hpp"
+
+#include <atomic>
+#include <unordered_set>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Single-threaded, edge-triggered epoll event loop.
+     *
+     * Owns the listening socket and every session accepted on it. Sockets
+     * are non-blocking: reads go straight into the session's receive buffer
+     * until the socket is drained, then the parser runs. The outbound queue
+     * of every session that sent something is written at the end of the loop
+     * turn with one gathered write; what the socket does not accept is
+     * written again when it becomes writable (EPOLLOUT).
+     **/
+    class Reactor : public Transport
+    {
+        private:
+            int epollDescriptor = -1;
+            int listenDescriptor = -1;
+            int wakeDescriptor = -1;
+
+            // Set by Stop(), possibly before Run() started.
+            atomic<bool> stopping { false };
+
+            // Accepting is retried by a timer after it failed.
+            bool acceptRetry = false;
+
+            unordered_set<Session*> sessions;
+
+            void Accept();
+            void Read(Session& session);
+            void Close(Session* session);
+            void FlushScheduled();
+
+        protected:
+            void Wake() override;
+
+        public:
+            Reactor();
+            ~Reactor() override;
+
+            Reactor(const Reactor&) = delete;
+            Reactor& operator=(const Reactor&) = delete;
+
+            int Listen(unsigned short port, int backlog = 1024) override;
+            int Run() override;
+            void Stop() override;
+
+            /**
+             * Write the session's outbound queue until it is empty or the socket is full.
+             * Returns 0, or -1 if the connection failed.
+             **/
+            static int Flush(Session& session);
+    };
+}
@@ -0,0 +1,595 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the FLV recorder.
+ **/
+
+#include "RTMPRecorder.hpp"
+#include "RTMPEndian.hpp"
+#include "RTMPMessage.hpp"
+#include "RTMPTrace.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace RTMP
+{
+    /**
+     * FLV header (audio and video), then the size of the previous tag: 0.
+     **/
+    static const unsigned char FlvHeader[13] = { 'F', 'L', 'V', 1, 0x05, 0, 0, 0, 9, 0, 0, 0, 0 };
+
+    static constexpr size_t TagHeaderSize = 11;
+
+    static void EncodeTagHeader(unsigned char* destination, int type, size_t length, unsigned int timestamp)
+    {
+        destination[0] = (unsigned char)type;
+        Endian::Store24BE(destination + 1, (uint32_t)length);
+        Endian::Store24BE(destination + 4, timestamp & 0xFFFFFF);
+        destination[7] = (unsigned char)(timestamp >> 24);
+        Endian::Store24BE(destination + 8, 0);
+    }
+
+    #ifndef _WIN32
+    /**
+     * Largest timestamp of the last tags of the FLV file open as
+     * `descriptor`, `end` bytes long: the last media tag, and the keyframe
+     * index that may follow it. 0 if there is no tag.
+     **/
+    static unsigned int LastTimestamp(int descriptor, off_t end)
+    {
+        unsigned int last = 0;
+        for (int i = 0; i < 2 && end > (off_t)sizeof(FlvHeader); i++)
+        {
+            unsigned char trailer[4];
+            if (pread(descriptor, trailer, sizeof(trailer), end - 4) != (ssize_t)sizeof(trailer))
+                break;
+
+            uint32_t size = Endian::Load32BE(trailer);
+            off_t start = end - 4 - (off_t)size;
+            if (size < TagHeaderSize || start < (off_t)sizeof(FlvHeader))
+                break;
+
+            unsigned char header[TagHeaderSize];
+            if (pread(descriptor, header, sizeof(header), start) != (ssize_t)sizeof(header))
+                break;
+
+            unsigned int timestamp = Endian::Load24BE(header + 4) | ((unsigned int)header[7] << 24);
+            if (timestamp > last)
+                last = timestamp;
+
+            // Only script data may follow the last media tag.
+            if ((header[0] & 0x1F) != Message::Type::AMF0DataMessage)
+                break;
+            end = start;
+        }
+        return last;
+    }
+    #endif
+
+    /**
+     * Recording.
+     **/
+
+    Recording::~Recording()
+    {
+        if (buffer != nullptr)
+            recorder.ReleaseBuffer(buffer);
+
+        #ifndef _WIN32
+        if (descriptor >= 0)
+            close(descriptor);
+        #endif
+    }
+
+    void Recording::Write(const MediaMessage& message)
+    {
+        if (closed || failed)
+            return;
+
+        if (!started)
+        {
+            started = true;
+            firstTimestamp = message.Timestamp();
+            if (!append)
+                Put(FlvHeader, sizeof(FlvHeader));
+        }
+
+        // Timestamps start at 0 in the file.
+        int offset = (int)(message.Timestamp() - firstTimestamp);
+        unsigned int timestamp = offset > 0 ? (unsigned int)offset : 0;
+
+        if (message.IsKeyframe() && !message.IsSequenceHeader())
+            keyframes.push_back(KeyframeEntry { timestamp, produced });
+
+        unsigned char header[TagHeaderSize];
+        EncodeTagHeader(header, message.Type(), message.Length(), timestamp);
+
+        unsigned char trailer[4];
+        Endian::Store32BE(trailer, (uint32_t)(TagHeaderSize + message.Length()));
+
+        Put(header, sizeof(header));
+        Put(message.Data(), message.Length());
+        Put(trailer, sizeof(trailer));
+    }
+
+    void Recording::Put(const unsigned char* data, size_t length)
+    {
+        while (length > 0 && !failed)
+        {
+            if (buffer == nullptr)
+            {
+                buffer = recorder.AcquireBuffer();
+                if (buffer == nullptr)
+                {
+                    RTMP_TRACE(Error, Handler,
+                        "Recording::Put",
+                        "Recorder is {} buffers behind, recording stopped.",
+                        Recorder::MaximumBuffers);
+                    failed = true;
+                    return;
+                }
+            }
+
+            size_t room = Recorder::BufferSize - used;
+            size_t count = length < room ? length : room;
+            memcpy(buffer + used, data, count);
+            used += count;
+            produced += count;
+            data += count;
+            length -= count;
+
+            if (used == Recorder::BufferSize)
+                Submit();
+        }
+    }
+
+    void Recording::Submit()
+    {
+        Recorder::Job job;
+        job.kind = Recorder::Job::Kind::Write;
+        job.recording = shared_from_this();
+        job.buffer = buffer;
+        job.length = used;
+        recorder.Submit(move(job));
+
+        buffer = nullptr;
+        used = 0;
+    }
+
+    void Recording::Close()
+    {
+        if (closed)
+            return;
+        closed = true;
+
+        // A recording cut short gets no index: its last tag may be torn.
+        if (failed)
+            keyframes.clear();
+
+        Recorder::Job job;
+        job.kind = Recorder::Job::Kind::Close;
+        job.recording = shared_from_this();
+        job.buffer = buffer;
+        job.length = used;
+        job.keyframes = move(keyframes);
+        recorder.Submit(move(job));
+
+        buffer = nullptr;
+        used = 0;
+    }
+
+    /**
+     * Recorder.
+     **/
+
+    Recorder::Recorder()
+    {
+        worker = thread(&Recorder::Work, this);
+    }
+
+    Recorder::~Recorder()
+    {
+        // Everything submitted is written first.
+        {
+            lock_guard<mutex> guard(lock);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+
+        for (unsigned char* buffer : freeBuffers)
+            free(buffer);
+    }
+
+    shared_ptr<Recording> Recorder::Open(const string& name, bool append)
+    {
+        shared_ptr<Recording> recording = make_shared<Recording>(*this, directory + "/" + FileName(name), append);
+
+        Job job;
+        job.kind = Job::Kind::Open;
+        job.recording = recording;
+        job.buffer = nullptr;
+        job.length = 0;
+        Submit(move(job));
+        return recording;
+    }
+
+    void Recorder::Run(function<void()> task)
+    {
+        Job job;
+        job.kind = Job::Kind::Task;
+        job.buffer = nullptr;
+        job.length = 0;
+        job.task = move(task);
+        Submit(move(job));
+    }
+
+    string Recorder::FileName(const string& name)
+    {
+        // The name comes from the client: keep the file in the directory.
+        string file = name;
+        for (char& character : file)
+        {
+            if (character == '/' || character == '\\' || character == ':')
+                character = '_';
+        }
+        if (file.empty() || file[0] == '.')
+            file.insert(file.begin(), '_');
+
+        return file + ".flv";
+    }
+
+    unsigned char* Recorder::AcquireBuffer()
+    {
+        lock_guard<mutex> guard(lock);
+
+        if (!freeBuffers.empty())
+        {
+            unsigned char* buffer = freeBuffers.back();
+            freeBuffers.pop_back();
+            return buffer;
+        }
+
+        if (buffers >= MaximumBuffers)
+            return nullptr;
+
+        void* memory = nullptr;
+        #ifdef _WIN32
+        memory = _aligned_malloc(BufferSize, Alignment);
+        #else
+        if (posix_memalign(&memory, Alignment, BufferSize) != 0)
+            memory = nullptr;
+        #endif
+        if (memory == nullptr)
+            return nullptr;
+
+        buffers++;
+        return static_cast<unsigned char*>(memory);
+    }
+
+    void Recorder::ReleaseBuffer(unsigned char* buffer)
+    {
+        // Kept for reuse; there are never more than MaximumBuffers.
+        lock_guard<mutex> guard(lock);
+        freeBuffers.push_back(buffer);
+    }
+
+    void Recorder::Submit(Job job)
+    {
+        {
+            lock_guard<mutex> guard(lock);
+            jobs.push_back(move(job));
+        }
+        wake.notify_one();
+    }
+
+    void Recorder::Work()
+    {
+        for (;;)
+        {
+            Job job;
+            {
+                unique_lock<mutex> guard(lock);
+                wake.wait(guard, [this]() { return stopping || !jobs.empty(); });
+                if (jobs.empty())
+                    return;
+
+                job = move(jobs.front());
+                jobs.pop_front();
+            }
+
+            switch (job.kind)
+            {
+                case Job::Kind::Open:
+                    Open(*job.recording);
+                    break;
+
+                case Job::Kind::Write:
+                    Retime(*job.recording, job.buffer, job.length);
+                    Write(*job.recording, job.buffer, job.length);
+                    ReleaseBuffer(job.buffer);
+                    break;
+
+                case Job::Kind::Close:
+                    Close(*job.recording, job.buffer, job.length, job.keyframes);
+                    if (job.buffer != nullptr)
+                        ReleaseBuffer(job.buffer);
+                    break;
+
+                case Job::Kind::Task:
+                    job.task();
+                    break;
+            }
+        }
+    }
+
+    /**
+     * I/O thread.
+     **/
+
+    void Recorder::Open(Recording& recording)
+    {
+        #ifndef _WIN32
+        // Appending reads the timestamp of the file's last tag.
+        int flags = O_CREAT | O_CLOEXEC | (recording.append ? O_RDWR : O_WRONLY | O_TRUNC);
+
+        string path = recording.path;
+        if (!recording.append)
+        {
+            static atomic<unsigned int> sequence { 0 };
+            path += "." + to_string(getpid()) + "." + to_string(sequence.fetch_add(1)) + ".part";
+        }
+
+        /**
+         * Direct I/O needs aligned offsets: only new files, which are
+         * written in whole buffers until the last one.
+         **/
+        #ifdef O_DIRECT
+        if (directIO && !recording.append)
+        {
+            recording.descriptor = open(path.c_str(), flags | O_DIRECT, 0644);
+            recording.direct = recording.descriptor >= 0;
+        }
+        #endif
+        if (recording.descriptor < 0)
+            recording.descriptor = open(path.c_str(), flags, 0644);
+
+        if (recording.descriptor < 0)
+        {
+            RTMP_TRACE(Error, Handler,
+                "Recorder::Open",
+                "Could not open the recording, errno {}.",
+                errno);
+            return;
+        }
+
+        if (!recording.append)
+            recording.temporary = path;
+
+        if (recording.append)
+        {
+            off_t end = lseek(recording.descriptor, 0, SEEK_END);
+            if (end == 0)
+            {
+                Write(recording, FlvHeader, sizeof(FlvHeader));
+                end = sizeof(FlvHeader);
+                recording.written = 0;
+            }
+            recording.base = end < 0 ? 0 : (uint64_t)end;
+            recording.timestampBase = end > 0 ? LastTimestamp(recording.descriptor, end) : 0;
+        }
+        #else
+        RTMP_TRACE(Error, Handler,
+            "Recorder::Open",
+            "Recording is not supported on this platform.");
+        #endif
+    }
+
+    void Recorder::Write(Recording& recording, const unsigned char* data, size_t length)
+    {
+        #ifndef _WIN32
+        while (length > 0 && recording.descriptor >= 0)
+        {
+            ssize_t result = pwrite(recording.descriptor, data, length, (off_t)(recording.base + recording.written));
+            if (result > 0)
+            {
+                data += result;
+                length -= result;
+                recording.written += result;
+                continue;
+            }
+            if (result < 0 && errno == EINTR)
+                continue;
+
+            #ifdef O_DIRECT
+            if (result < 0 && errno == EINVAL && recording.direct)
+            {
+                // The filesystem refuses direct I/O after all.
+                fcntl(recording.descriptor, F_SETFL, fcntl(recording.descriptor, F_GETFL) & ~O_DIRECT);
+                recording.direct = false;
+                continue;
+            }
+            #endif
+
+            RTMP_TRACE(Error, Handler,
+                "Recorder::Write",
+                "Could not write the recording, errno {}.",
+                errno);
+            close(recording.descriptor);
+            recording.descriptor = -1;
+        }
+        #endif
+    }
+
+    void Recorder::Retime(Recording& recording, unsigned char* buffer, size_t length)
+    {
+        if (recording.timestampBase == 0)
+            return;
+
+        uint64_t start = recording.retimed;
+        recording.retimed += length;
+
+        while (recording.nextTag < recording.retimed)
+        {
+            size_t index = (size_t)(recording.nextTag + recording.tagUsed - start);
+            while (recording.tagUsed < TagHeaderSize && index < length)
+                recording.tag[recording.tagUsed++] = buffer[index++];
+            if (recording.tagUsed < TagHeaderSize)
+                return;
+
+            unsigned char* stamp = recording.tag + 4;
+            unsigned int timestamp = (Endian::Load24BE(stamp) | ((unsigned int)stamp[3] << 24)) + recording.timestampBase;
+            Endian::Store24BE(stamp, timestamp & 0xFFFFFF);
+            stamp[3] = (unsigned char)(timestamp >> 24);
+
+            uint64_t position = recording.nextTag + 4;
+            for (uint64_t i = 0; i < 4; i++)
+            {
+                if (position + i >= start)
+                    buffer[position + i - start] = stamp[i];
+            }
+
+            #ifndef _WIN32
+            // Begun in the previous buffer, which is written: fix it in the file.
+            if (position < start && recording.descriptor >= 0
+                && pwrite(recording.descriptor, stamp, 4, (off_t)(recording.base + position)) != 4)
+            {
+                RTMP_TRACE(Error, Handler,
+                    "Recorder::Retime",
+                    "Could not write the recording, errno {}.",
+                    errno);
+            }
+            #endif
+
+            recording.nextTag += TagHeaderSize + Endian::Load24BE(recording.tag + 1) + 4;
+            recording.tagUsed = 0;
+        }
+    }
+
+    void Recorder::Close(Recording& recording, unsigned char* buffer, size_t length, vector<KeyframeEntry>& keyframes)
+    {
+        #ifndef _WIN32
+        if (recording.descriptor < 0)
+        {
+            // Stopped by a write error: what was written is kept.
+            Finish(recording);
+            return;
+        }
+
+        // The last buffer is partial: leave direct I/O for the tail of the file.
+        #ifdef O_DIRECT
+        if (recording.direct)
+        {
+            fcntl(recording.descriptor, F_SETFL, fcntl(recording.descriptor, F_GETFL) & ~O_DIRECT);
+            recording.direct = false;
+        }
+        #endif
+
+        if (buffer != nullptr && length > 0)
+        {
+            Retime(recording, buffer, length);
+            Write(recording, buffer, length);
+        }
+
+        if (!keyframes.empty())
+        {
+            /**
+             * Script data tag: "keyframes", then an object of two strict
+             * arrays, the times in seconds and the file positions.
+             **/
+            vector<unsigned char> body;
+            auto putString = [&body](const char* text) {
+                size_t size = strlen(text);
+                body.push_back((unsigned char)(size >> 8));
+                body.push_back((unsigned char)size);
+                body.insert(body.end(), text, text + size);
+            };
+            auto putArray = [&body, &keyframes](bool times) {
+                unsigned char count[4];
+                Endian::Store32BE(count, (uint32_t)keyframes.size());
+                body.push_back(0x0A);
+                body.insert(body.end(), count, count + 4);
+                for (const KeyframeEntry& entry : keyframes)
+                {
+                    double value = times ? entry.timestamp / 1000.0 : (double)entry.position;
+                    uint64_t bits;
+                    memcpy(&bits, &value, sizeof(bits));
+
+                    unsigned char number[9];
+                    number[0] = 0x00;
+                    Endian::Store64BE(number + 1, bits);
+                    body.insert(body.end(), number, number + 9);
+                }
+            };
+
+            // File positions and times are known here, once the appended file is.
+            for (KeyframeEntry& entry : keyframes)
+            {
+                entry.position += recording.base;
+                entry.timestamp += recording.timestampBase;
+            }
+
+            body.push_back(0x02);
+            putString("keyframes");
+            body.push_back(0x03);
+            putString("times");
+            putArray(true);
+            putString("filepositions");
+            putArray(false);
+            body.push_back(0x00);
+            body.push_back(0x00);
+            body.push_back(0x09);
+
+            unsigned char header[TagHeaderSize];
+            EncodeTagHeader(header, Message::Type::AMF0DataMessage, body.size(), keyframes.back().timestamp);
+
+            unsigned char trailer[4];
+            Endian::Store32BE(trailer, (uint32_t)(TagHeaderSize + body.size()));
+
+            Write(recording, header, sizeof(header));
+            Write(recording, body.data(), body.size());
+            Write(recording, trailer, sizeof(trailer));
+        }
+
+        Finish(recording);
+        #endif
+    }
+
+    void Recorder::Finish(Recording& recording)
+    {
+        #ifndef _WIN32
+        if (recording.descriptor >= 0)
+        {
+            close(recording.descriptor);
+            recording.descriptor = -1;
+        }
+
+        // Sessions playing the file replaced keep their mapping of it.
+        if (!recording.temporary.empty() && rename(recording.temporary.c_str(), recording.path.c_str()) != 0)
+        {
+            RTMP_TRACE(Error, Handler,
+                "Recorder::Finish",
+                "Could not replace the recording, errno {}.",
+                errno);
+            remove(recording.temporary.c_str());
+        }
+        recording.temporary.clear();
+        #endif
+    }
+
+    Recorder& Recorder::Default()
+    {
+        static Recorder recorder;
+        return recorder;
+    }
+}
@@ -0,0 +1,229 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * FLV recording of published streams.
+ **/
+
+#include "RTMPMedia.hpp"
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    class Recorder;
+
+    /**
+     * Position of a keyframe tag in a recording.
+     **/
+    struct KeyframeEntry
+    {
+        // Milliseconds from the start of the recording.
+        unsigned int timestamp;
+
+        // Offset of the tag in the file.
+        uint64_t position;
+    };
+
+    /**
+     * One FLV file being written.
+     *
+     * The publisher's thread encodes tags into large aligned buffers and
+     * hands every full buffer to the recorder's I/O thread; it never calls
+     * into the filesystem. On close, the keyframe index is appended to the
+     * file as a "keyframes" script data tag (times and file positions).
+     **/
+    class Recording : public enable_shared_from_this<Recording>
+    {
+        private:
+            friend class Recorder;
+
+            Recorder& recorder;
+            string path;
+            bool append;
+
+            /**
+             * Publisher's thread.
+             **/
+            unsigned char* buffer = nullptr;
+            size_t used = 0;
+
+            // Bytes produced since the recording started.
+            uint64_t produced = 0;
+
+            bool started = false;
+            bool closed = false;
+            bool failed = false;
+            unsigned int firstTimestamp = 0;
+            vector<KeyframeEntry> keyframes;
+
+            /**
+             * I/O thread.
+             **/
+            int descriptor = -1;
+            bool direct = false;
+
+            /**
+             * File written instead of path, renamed over it on close, so that
+             * a file being played is replaced rather than truncated under its
+             * mapping. Empty when appending, which only grows the file.
+             **/
+            string temporary;
+
+            // File offset of the first byte produced, past an appended file's content.
+            uint64_t base = 0;
+
+            // Bytes written so far, from base.
+            uint64_t written = 0;
+
+            /**
+             * Appending: added to the timestamps of the tags produced, so
+             * that they follow the last one of the file.
+             **/
+            unsigned int timestampBase = 0;
+
+            // Bytes retimed so far, and offset of the next tag header, from base.
+            uint64_t retimed = 0;
+            uint64_t nextTag = 0;
+
+            // Header of the next tag, which may span two buffers.
+            unsigned char tag[11];
+            size_t tagUsed = 0;
+
+            void Put(const unsigned char* data, size_t length);
+            void Submit();
+
+        public:
+            Recording(Recorder& recorder, const string& path, bool append)
+                : recorder(recorder), path(path), append(append) {};
+            ~Recording();
+
+            Recording(const Recording&) = delete;
+            Recording& operator=(const Recording&) = delete;
+
+            const string& Path() const { return path; }
+
+            /**
+             * Append `message` as an FLV tag. Called from the publisher's thread.
+             **/
+            void Write(const MediaMessage& message);
+
+            /**
+             * Write what is buffered and the keyframe index, then close the file.
+             **/
+            void Close();
+    };
+
+    /**
+     * Writes recordings on a dedicated I/O thread.
+     *
+     * Buffers are BufferSize bytes, aligned for O_DIRECT. Every buffer waits
+     * in one queue, which the I/O thread writes in order; the publishers
+     * only lock it to hand over a full buffer. When the disk falls behind by
+     * more than MaximumBuffers, recordings are stopped rather than letting
+     * memory grow.
+     **/
+    class Recorder
+    {
+        private:
+            friend class Recording;
+
+            struct Job
+            {
+                enum class Kind
+                {
+                    Open,
+                    Write,
+                    Close,
+                    Task
+                };
+
+                Kind kind;
+                shared_ptr<Recording> recording;
+                unsigned char* buffer;
+                size_t length;
+                vector<KeyframeEntry> keyframes;
+                function<void()> task;
+            };
+
+            string directory = ".";
+            bool directIO = false;
+
+            mutex lock;
+            condition_variable wake;
+            deque<Job> jobs;
+            vector<unsigned char*> freeBuffers;
+            size_t buffers = 0;
+            bool stopping = false;
+
+            thread worker;
+
+            unsigned char* AcquireBuffer();
+            void ReleaseBuffer(unsigned char* buffer);
+            void Submit(Job job);
+
+            void Work();
+            void Open(Recording& recording);
+            void Write(Recording& recording, const unsigned char* data, size_t length);
+            void Retime(Recording& recording, unsigned char* buffer, size_t length);
+            void Close(Recording& recording, unsigned char* buffer, size_t length, vector<KeyframeEntry>& keyframes);
+            void Finish(Recording& recording);
+
+        public:
+            static constexpr size_t BufferSize = 1024 * 1024;
+            static constexpr size_t Alignment = 4096;
+            static constexpr size_t MaximumBuffers = 256;
+
+            Recorder();
+            ~Recorder();
+
+            Recorder(const Recorder&) = delete;
+            Recorder& operator=(const Recorder&) = delete;
+
+            /**
+             * Directory recordings are written in. Set before recording.
+             **/
+            void SetDirectory(const string& path) { directory = path; }
+
+            /**
+             * Write new recordings with O_DIRECT, bypassing the page cache.
+             * Falls back to buffered writes where it is not supported.
+             **/
+            void SetDirectIO(bool enable) { directIO = enable; }
+
+            /**
+             * Start recording stream `name` to <directory>/<name>.flv, replaced
+             * on close or appended to; appended tags are timed from the
+             * file's last one. Returns immediately; the file is opened by the
+             * I/O thread.
+             **/
+            shared_ptr<Recording> Open(const string& name, bool append);
+
+            /**
+             * Run `task` on the I/O thread, after the jobs submitted before
+             * it: file work too slow for the transports' threads.
+             **/
+            void Run(function<void()> task);
+
+            /**
+             * File stream `name` is recorded to, relative to the directory.
+             **/
+            static string FileName(const string& name);
+
+            /**
+             * Recorder used by the handler.
+             **/
+            static Recorder& Default();
+    };
+}
@@ -1,56 +1,82 @@
 #include "RTMPResponse.hpp"
+#include "RTMPAMF0Template.hpp"
 
 namespace RTMP
 {
+    /**
+     * Response templates, encoded at compile time.
+     **/
+
+    static constexpr AMF0Template ConnectResult = AMF0Template()
+        .String("_result")
+        .NumberSlot()
+        .ObjectStart()
+            .Key("fmsVer").String("FMS/3,0,1,123")
+            .Key("capabilities").Integer(31)
+        .ObjectEnd()
+        .ObjectStart()
+            .Key("level").String("status")
+            .Key("code").String("NetConnection.Connect.Success")
+            .Key("description").String("Connection succeeded.")
+            .Key("objectEncoding").NumberSlot()
+        .ObjectEnd();
+
+    static constexpr AMF0Template CreateStreamResult = AMF0Template()
+        .String("_result")
+        .NumberSlot()
+        .Null()
+        .NumberSlot();
+
+    // Up to the code, then the description, and the end of the object.
+    // By level: status, warning, error.
+    static constexpr AMF0Template OnStatusHeads[3] = {
+        AMF0Template()
+            .String("onStatus")
+            .Integer(0)
+            .Null()
+            .ObjectStart()
+                .Key("level").String("status")
+                .Key("code"),
+        AMF0Template()
+            .String("onStatus")
+            .Integer(0)
+            .Null()
+            .ObjectStart()
+                .Key("level").String("warning")
+                .Key("code"),
+        AMF0Template()
+            .String("onStatus")
+            .Integer(0)
+            .Null()
+            .ObjectStart()
+                .Key("level").String("error")
+                .Key("code")
+    };
+
+    static constexpr AMF0Template OnStatusDescription = AMF0Template()
+        .Key("description");
+
+    static constexpr AMF0Template ObjectEnd = AMF0Template()
+        .ObjectEnd();
+
     vector<char> ServerResponse::ConnectResponse(Session& session)
     {
         vector<char> data;
         
-        Netconnection::Connect* command = dynamic_cast<Netconnection::Connect*>(session.pendingCommand);
-        if (command == NULL)
+        const AMF0Command* command = session.pendingCommand;
+        if (command == nullptr || command->type != Netconnection::CommandType::Connect)
         {
-            Utils::FormatedPrint::PrintError("ServerResponse::ConnectResponse", "Netconnection::Connect command cast failed.");
+            RTMP_TRACE(Error, Response, "ServerResponse::ConnectResponse", "No connect command being handled.");
             return data;
         }
-        bool success = true;
-        string commandName = success ? "_result" : "_error";
-        int transactionID = 1;
-        
-
-        Utils::AMF0::Data commandNameData =
-            Utils::AMF0Encoder::EncodeString(commandName, true);
-
-        Utils::AMF0::Data transactionIDData = 
-            Utils::AMF0Encoder::EncodeNumber(transactionID);
-
-        /**
-         * Properties object.
-         */
-        Utils::Object propertiesObject;
-        
-        Utils::Field<string> fmsVerField;
-        fmsVerField.value = "FMS/3,0,1,123";
-
-        Utils::Field<double> capabilitiesField;
-        capabilitiesField.value = 31;
-
-        pair<Utils::PropertyType, Utils::Field<string>*> fmsPair {Utils::PropertyType::fmsVer, &fmsVerField};
-        pair<Utils::PropertyType, Utils::Field<double>*> capabilitiesPair {Utils::PropertyType::capabilities, &capabilitiesField};
-        propertiesObject.insert(fmsPair);
-        propertiesObject.insert(capabilitiesPair);
-
-        Utils::AMF0::Data propertiesData = 
-            Utils::AMF0Encoder::EncodeObject(propertiesObject);
-
-        for (int i = 0; i < propertiesData.size; i++)
-            printf("\n->%X", propertiesData.data[i]);
 
-        data.insert(data.end(), commandNameData.data, commandNameData.data + commandNameData.size);
-        data.insert(data.end(), transactionIDData.data, transactionIDData.data + transactionIDData.size);
-        data.insert(data.end(), propertiesData.data, propertiesData.data + propertiesData.size);
+        data.reserve(ConnectResult.Length());
+        ConnectResult.AppendTo(data);
+        AMF0Template::PatchNumber(data, ConnectResult.Slot(0), command->transactionID);
+        AMF0Template::PatchNumber(data, ConnectResult.Slot(1), session.objectEncoding);
 
+        RTMP_TRACE_BYTES(Response, data.data(), data.size());
         return data;
-        
     }
 
     vector<char> ServerResponse::CallResponse(Session& session)
@@ -64,41 +90,24 @@ namespace RTMP
     {
         vector<char> data;
         
-        Netconnection::CreateStream* command = dynamic_cast<Netconnection::CreateStream*>(session.pendingCommand);
-        if (command == NULL)
+        const AMF0Command* command = session.pendingCommand;
+        if (command == nullptr || command->type != Netconnection::CommandType::CreateStream)
         {
-            Utils::FormatedPrint::PrintError("ServerResponse::ConnectResponse", "Netconnection::Connect command cast failed.");
+            RTMP_TRACE(Error, Response, "ServerResponse::CreateStreamResponse", "No createStream command being handled.");
             return data;
         }
 
-        bool success = true;
-
-        string commandName = success ? "_result" : "_error";
-        
         session.streamID = 10;
-        session.lastChunk->basicHeader.fmt = 0;
-        session.lastChunk->messageHeader.message_stream_id = 0;
-
-        Utils::Object commandObject;
-        commandObject.insert(pair<Utils::PropertyType, Utils::Property*>(Utils::PropertyType::app, new Utils::Field<string>("test")));
-
-        Utils::AMF0::Data commandNameData =
-            Utils::AMF0Encoder::EncodeString(commandName, true);
-
-        Utils::AMF0::Data transactionIDData = 
-            Utils::AMF0Encoder::EncodeNumber(command->TransactionID);
-
-        Utils::AMF0::Data streamIDData = 
-            Utils::AMF0Encoder::EncodeNumber(session.streamID);
-
-        Utils::AMF0::Data commandObjectData = 
-            Utils::AMF0Encoder::EncodeObject(commandObject);
-        Utils::FormatedPrint::PrintBytes<unsigned char>(commandObjectData.data, commandObjectData.size);
+        if (session.lastChunk != nullptr)
+        {
+            session.lastChunk->basicHeader.fmt = 0;
+            session.lastChunk->messageHeader.message_stream_id = 0;
+        }
 
-        data.insert(data.end(), commandNameData.data, commandNameData.data + commandNameData.size);
-        data.insert(data.end(), transactionIDData.data, transactionIDData.data + transactionIDData.size);
-        data.insert(data.end(), commandObjectData.data, commandObjectData.data + commandObjectData.size);
-        data.insert(data.end(), streamIDData.data, streamIDData.data + streamIDData.size);
+        data.reserve(CreateStreamResult.Length());
+        CreateStreamResult.AppendTo(data);
+        AMF0Template::PatchNumber(data, CreateStreamResult.Slot(0), command->transactionID);
+        AMF0Template::PatchNumber(data, CreateStreamResult.Slot(1), session.streamID);
 
         return data;
     }
@@ -107,64 +116,53 @@ namespace RTMP
     {
         vector<char> data;
 
-        Utils::Object commandObject;
-        Utils::AMF0::Data amfdata;
-
-        session.lastChunk->basicHeader.fmt = 0;
+        if (session.lastChunk != nullptr)
+            session.lastChunk->basicHeader.fmt = 0;
 
-        string commandNameString = "onStatus";
+        const AMF0Template& head = OnStatusHeads[level == 2 ? 2 : level ? 1 : 0];
+        data.reserve(head.Length() + 3 + code.size() + OnStatusDescription.Length() + 3 + description.size() + ObjectEnd.Length());
 
-        // Command name.
-        amfdata = Utils::AMF0Encoder::EncodeString(commandNameString, true);
-        data.insert(data.end(), amfdata.data, amfdata.data + amfdata.size);
+        head.AppendTo(data);
+        AMF0Template::AppendString(data, code);
 
-        // Transaction ID.
-        amfdata = Utils::AMF0Encoder::EncodeNumber(0.0);
-        data.insert(data.end(), amfdata.data, amfdata.data + amfdata.size);
-
-        // Null marker.
-        data.insert(data.end(), 1, Utils::AMF0::type_markers::null_marker);
-
-        // Level field
-        commandObject.insert(pair<Utils::PropertyType, Utils::Property*>(Utils::PropertyType::level, new Utils::Field<string>(level ? "warning" : "status")));
-
-        // Code field
-        commandObject.insert(pair<Utils::PropertyType, Utils::Property*>(Utils::PropertyType::code, new Utils::Field<string>(code)));
-
-        // Description field.
         if (description != "")
-            commandObject.insert(pair<Utils::PropertyType, Utils::Property*>(Utils::PropertyType::description, new Utils::Field<string>(description)));
+        {
+            OnStatusDescription.AppendTo(data);
+            AMF0Template::AppendString(data, description);
+        }
         
-        // Command object.
-        amfdata = Utils::AMF0Encoder::EncodeObject(commandObject);
-        data.insert(data.end(), amfdata.data, amfdata.data + amfdata.size);
-
+        ObjectEnd.AppendTo(data);
         return data;
     }
 
-    vector<char> ServerResponse::StreamBegin(Session& session)
+    static vector<char> StreamEvent(UserControlMessage::EventType eventType, int streamID)
     {
-        vector<char> data;
-
         /**
          * EventType -> 2 bytes.
          * EventData -> 4 bytes.
          */
-        
-        UserControlMessage::EventType eventType = 
-            UserControlMessage::EventType::StreamBegin;
-        session.streamID = 10;
-        char eventData[4] = {
-            session.streamID >> 24,
-            (session.streamID >> 16) & 0xFF,
-            (session.streamID >> 8) & 0xFF,
-            session.streamID & 0xFF
-        };
-        data.insert(data.end(), 1, 0);
-        data.insert(data.end(), 1, (char) eventType);
-        data.insert(data.end(), eventData, eventData + 4);
+        vector<char> data(6);
+        unsigned char* bytes = reinterpret_cast<unsigned char*>(data.data());
+        Endian::Store16BE(bytes, (uint16_t)eventType);
+        Endian::Store32BE(bytes + 2, (uint32_t)streamID);
 
         return data;
+    }
+
+    vector<char> ServerResponse::StreamBegin(Session& session)
+    {
+        session.streamID = 10;
+        return StreamEvent(UserControlMessage::EventType::StreamBegin, session.streamID);
     } 
 
+    vector<char> ServerResponse::StreamEOF(Session& session)
+    {
+        return StreamEvent(UserControlMessage::EventType::StreamEOF, session.streamID);
+    }
+
+    vector<char> ServerResponse::StreamIsRecorded(Session& session)
+    {
+        return StreamEvent(UserControlMessage::EventType::StreamIsRecorded, session.streamID);
+    }
+
 }
\ No newline at end of file
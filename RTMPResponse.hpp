@@ -15,8 +15,8 @@
 #include "RTMPSession.hpp"
 
 #include "Netconnection.hpp"
+#include "RTMPTrace.hpp"
 
-#include <utils/FormatedPrint.hpp>
 #include <utils/amf0.hpp>
 
 using namespace std;
@@ -31,9 +31,12 @@ namespace RTMP
             static vector<char> ConnectResponse(Session&);
             static vector<char> CallResponse(Session&);
             static vector<char> CreateStreamResponse(Session&);
+            // Level: 0 status, 1 warning, 2 error.
             static vector<char> OnStatus(Session&, int level, string code, string description = "");
 
             // User Control messages.
             static vector<char> StreamBegin(Session&); 
+            static vector<char> StreamEOF(Session&);
+            static vector<char> StreamIsRecorded(Session&);
     };
 }
\ No newline at end of file
@@ -0,0 +1,125 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the chunk serializer.
+ **/
+
+#include "RTMPSerializer.hpp"
+#include "RTMPEndian.hpp"
+
+namespace RTMP
+{
+    /**
+     * Message header encoders, indexed by chunk format.
+     * `timestamp` is the 24-bit field, already clamped.
+     **/
+    typedef unsigned char* (*MessageHeaderEncoder)(unsigned char* destination, const ChunkHeader::MessageHeader& header, unsigned int timestamp);
+
+    static unsigned char* EncodeMessageHeaderType0(unsigned char* destination, const ChunkHeader::MessageHeader& header, unsigned int timestamp)
+    {
+        // 11-byte message header.
+        Endian::Store24BE(destination, timestamp);
+        Endian::Store24BE(destination + 3, header.message_length);
+        destination[6] = (unsigned char)header.message_type_id;
+        Endian::Store32LE(destination + 7, header.message_stream_id);
+        return destination + 11;
+    }
+
+    static unsigned char* EncodeMessageHeaderType1(unsigned char* destination, const ChunkHeader::MessageHeader& header, unsigned int timestamp)
+    {
+        // 7-byte message header.
+        Endian::Store24BE(destination, timestamp);
+        Endian::Store24BE(destination + 3, header.message_length);
+        destination[6] = (unsigned char)header.message_type_id;
+        return destination + 7;
+    }
+
+    static unsigned char* EncodeMessageHeaderType2(unsigned char* destination, const ChunkHeader::MessageHeader&, unsigned int timestamp)
+    {
+        // 3-byte message header.
+        Endian::Store24BE(destination, timestamp);
+        return destination + 3;
+    }
+
+    static unsigned char* EncodeMessageHeaderType3(unsigned char* destination, const ChunkHeader::MessageHeader&, unsigned int)
+    {
+        // No message header.
+        return destination;
+    }
+
+    static const MessageHeaderEncoder MessageHeaderEncoders[4] = {
+        EncodeMessageHeaderType0,
+        EncodeMessageHeaderType1,
+        EncodeMessageHeaderType2,
+        EncodeMessageHeaderType3
+    };
+
+    size_t Serializer::EncodeChunkHeader(const Chunk& chunk, unsigned char* destination)
+    {
+        unsigned int fmt = chunk.basicHeader.fmt & 3;
+        unsigned int csid = chunk.basicHeader.csid;
+        unsigned char* position = destination;
+
+        /**
+         * Basic header: 1 byte for chunk streams 2-63, 2 bytes up to 319,
+         * 3 bytes up to 65599. IDs past 63 are sent minus 64, little-endian.
+         **/
+        if (csid >= 2 && csid <= 63)
+        {
+            *position++ = (unsigned char)((fmt << 6) | csid);
+        }
+        else if (csid >= 64 && csid <= 319)
+        {
+            *position++ = (unsigned char)(fmt << 6);
+            *position++ = (unsigned char)(csid - 64);
+        }
+        else if (csid >= 320 && csid <= 65599)
+        {
+            *position++ = (unsigned char)((fmt << 6) | 1);
+            *position++ = (unsigned char)((csid - 64) & 0xFF);
+            *position++ = (unsigned char)((csid - 64) >> 8);
+        }
+        else
+        {
+            return 0;
+        }
+
+        /**
+         * Message header, then the extended timestamp.
+         **/
+        if (fmt == ChunkHeader::MessageHeader::ChunkHeaderFormat::Type3)
+        {
+            if (chunk.hasExtendedTimestamp)
+            {
+                Endian::Store32BE(position, (unsigned int)chunk.extendedTimestamp);
+                position += 4;
+            }
+            return position - destination;
+        }
+
+        unsigned int timestamp = (unsigned int)chunk.messageHeader.timestamp_delta;
+        bool extended = timestamp >= 0xFFFFFF;
+
+        position = MessageHeaderEncoders[fmt](position, chunk.messageHeader, extended ? 0xFFFFFF : timestamp);
+        if (extended)
+        {
+            Endian::Store32BE(position, timestamp);
+            position += 4;
+        }
+        return position - destination;
+    }
+
+    size_t Serializer::GatherChunk(const Chunk& chunk, unsigned char* header, const unsigned char* payload, size_t length, Slice* slices)
+    {
+        size_t headerLength = EncodeChunkHeader(chunk, header);
+        if (headerLength == 0)
+            return 0;
+
+        slices[0].data = header;
+        slices[0].length = headerLength;
+        slices[1].data = payload;
+        slices[1].length = length;
+        return 2;
+    }
+}
@@ -0,0 +1,47 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * RTMP chunk serializer.
+ **/
+
+#include "RTMPChunk.hpp"
+#include "RTMPOutbound.hpp"
+
+#include <cstddef>
+
+namespace RTMP
+{
+    /**
+     * Encodes chunk headers straight into a caller-provided buffer.
+     *
+     * Nothing is allocated and payloads are never copied: a chunk goes out
+     * as its header bytes followed by a slice over the payload.
+     **/
+    class Serializer
+    {
+        public:
+            /**
+             * Encode the basic header, message header and extended timestamp
+             * of `chunk` into `destination`, which holds at least
+             * MAX_CHUNK_HEADER_SIZE bytes.
+             *
+             * The timestamp field (messageHeader.timestamp_delta) is the
+             * absolute timestamp for Type 0 chunks and the delta for Type 1
+             * and 2 chunks; an extended timestamp is written when it does not
+             * fit in 24 bits. Type 3 chunks repeat chunk.extendedTimestamp
+             * when chunk.hasExtendedTimestamp is set.
+             *
+             * Returns the header length, or 0 if the chunk stream ID is out of range.
+             **/
+            static size_t EncodeChunkHeader(const Chunk& chunk, unsigned char* destination);
+
+            /**
+             * Encode the header of `chunk` into `header` and describe the chunk
+             * as two slices: the header, then `length` payload bytes in place.
+             * Returns the number of slices, 0 on error.
+             **/
+            static size_t GatherChunk(const Chunk& chunk, unsigned char* header, const unsigned char* payload, size_t length, Slice* slices);
+    };
+}
@@ -0,0 +1,143 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the thread-per-core server.
+ **/
+
+#include "RTMPServer.hpp"
+#include "RTMPTrace.hpp"
+#include "RTMPStreamRegistry.hpp"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace RTMP
+{
+    Server::Server(Transport::Backend backend, unsigned shardCount, bool pinThreads)
+        : pinThreads(pinThreads)
+    {
+        if (shardCount == 0)
+            shardCount = thread::hardware_concurrency();
+        if (shardCount == 0)
+            shardCount = 1;
+
+        for (unsigned i = 0; i < shardCount; i++)
+        {
+            unique_ptr<Shard> shard(new Shard);
+            shard->index = i;
+            shard->transport = Transport::Create(backend);
+            if (shard->transport == nullptr)
+            {
+                RTMP_TRACE(Error, Transport,
+                    "Server::Server",
+                    "No transport for shard {}.",
+                    i);
+                shards.clear();
+                return;
+            }
+            shard->transport->SetBufferPool(shard->bufferPool);
+            shard->transport->SetReusePort(true);
+            shards.push_back(move(shard));
+        }
+    }
+
+    Server::~Server()
+    {
+        Stop();
+    }
+
+    int Server::Listen(unsigned short port, int backlog)
+    {
+        if (shards.empty())
+            return -1;
+
+        for (unique_ptr<Shard>& shard : shards)
+        {
+            if (shard->transport->Listen(port, backlog) < 0)
+                return -1;
+        }
+        return 0;
+    }
+
+    void Server::Start()
+    {
+        for (unique_ptr<Shard>& shard : shards)
+        {
+            Shard* target = shard.get();
+            shard->worker = thread([this, target] { Work(*target); });
+        }
+    }
+
+    void Server::Stop()
+    {
+        for (unique_ptr<Shard>& shard : shards)
+        {
+            if (shard->worker.joinable())
+                shard->transport->Stop();
+        }
+        for (unique_ptr<Shard>& shard : shards)
+        {
+            if (shard->worker.joinable())
+                shard->worker.join();
+        }
+    }
+
+    size_t Server::SessionCount() const
+    {
+        size_t count = 0;
+        for (const unique_ptr<Shard>& shard : shards)
+            count += shard->transport->SessionCount();
+        return count;
+    }
+
+    void Server::Work(Shard& shard)
+    {
+        Shard::current = &shard;
+        shard.bufferPool->BindToCurrentThread();
+
+        #ifdef __linux__
+        if (pinThreads)
+        {
+            /**
+             * Pin to the index-th core the process may run on.
+             **/
+            cpu_set_t allowed;
+            CPU_ZERO(&allowed);
+            if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0 && CPU_COUNT(&allowed) > 0)
+            {
+                unsigned target = shard.index % CPU_COUNT(&allowed);
+                for (int cpu = 0; cpu < CPU_SETSIZE; cpu++)
+                {
+                    if (!CPU_ISSET(cpu, &allowed))
+                        continue;
+                    if (target-- > 0)
+                        continue;
+
+                    cpu_set_t pinned;
+                    CPU_ZERO(&pinned);
+                    CPU_SET(cpu, &pinned);
+                    pthread_setaffinity_np(pthread_self(), sizeof(pinned), &pinned);
+
+                    RTMP_TRACE(Debug, Transport,
+                        "Server::Work",
+                        "Shard {} pinned to core {}.",
+                        shard.index, cpu);
+                    break;
+                }
+            }
+        }
+        #endif
+
+        shard.transport->Run();
+        Shard::current = nullptr;
+    }
+
+    void Server::SetAggregation(unsigned int window, size_t largestMessage)
+    {
+        // Streams of every shard share the default registry.
+        StreamRegistry::Default().SetAggregation(window, largestMessage);
+    }
+}
@@ -0,0 +1,116 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Thread-per-core server.
+ **/
+
+#include "RTMPTransport.hpp"
+#include "RTMPBufferPool.hpp"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * State owned by one worker thread.
+     *
+     * A session is handled from start to end by the shard that accepted it,
+     * with the shard's own allocator, so nothing on the per-message path is
+     * shared between threads.
+     **/
+    struct Shard
+    {
+        unsigned index = 0;
+
+        /**
+         * Abandoned with the shard: messages taken from it may still be
+         * held by other shards or the stream caches.
+         **/
+        BufferPool* bufferPool = new BufferPool;
+        unique_ptr<Transport> transport;
+
+        thread worker;
+
+        /**
+         * Shard of the calling thread, nullptr outside of the workers.
+         **/
+        static Shard* Current() { return current; }
+
+        ~Shard()
+        {
+            // The sessions release their buffers first.
+            transport.reset();
+            bufferPool->Abandon();
+        }
+
+        private:
+            static inline thread_local Shard* current = nullptr;
+
+            friend class Server;
+    };
+
+    /**
+     * Multi-reactor server.
+     *
+     * Every shard listens on the same port with its own SO_REUSEPORT socket
+     * and runs its own event loop on a worker thread pinned to a core.
+     **/
+    class Server
+    {
+        private:
+            vector<unique_ptr<Shard>> shards;
+            bool pinThreads;
+
+            void Work(Shard& shard);
+
+        public:
+            /**
+             * `shardCount` defaults to one shard per available core.
+             **/
+            Server(Transport::Backend backend = Transport::Backend::Epoll, unsigned shardCount = 0, bool pinThreads = true);
+            ~Server();
+
+            Server(const Server&) = delete;
+            Server& operator=(const Server&) = delete;
+
+            /**
+             * Listen on `port` from every shard. Returns 0, or -1 on failure
+             * or if the server is not valid.
+             **/
+            int Listen(unsigned short port, int backlog = 1024);
+
+            /**
+             * Start the worker threads.
+             **/
+            void Start();
+
+            /**
+             * Stop the event loops and wait for the workers to return.
+             **/
+            void Stop();
+
+            /**
+             * Whether the shards could be created: false when the platform
+             * has no transport backend.
+             **/
+            bool Valid() const { return !shards.empty(); }
+
+            size_t ShardCount() const { return shards.size(); }
+            Shard& GetShard(size_t index) { return *shards[index]; }
+
+            size_t SessionCount() const;
+
+            /**
+             * Pack the small audio and video messages of the streams published
+             * from now on into aggregates spanning `window` milliseconds
+             * (see LiveStream::SetAggregation). 0, the default, turns it off.
+             **/
+            void SetAggregation(unsigned int window, size_t largestMessage);
+    };
+}
@@ -9,40 +9,146 @@
 
 #include "RTMPHandshake.hpp"
 #include "RTMPChunk.hpp"
+#include "RTMPChunkStream.hpp"
+#include "RTMPBuffer.hpp"
+#include "RTMPOutbound.hpp"
+#include "RTMPLiveStream.hpp"
+#include "RTMPEgress.hpp"
+#include "RTMPRecorder.hpp"
+#include "RTMPVod.hpp"
+#include "RTMPAMF0.hpp"
 #include "Netconnection.hpp"
 
 #include <vector>
+#include <memory>
 #ifdef _WIN32
 #include <WinSock2.h>
 #pragma comment (lib, "Ws2_32.lib")
 #pragma comment (lib, "Mswsock.lib")
 #pragma comment (lib, "AdvApi32.lib")
+#else
+typedef int SOCKET;
+#define INVALID_SOCKET (-1)
 #endif
 
 using namespace std;
 
 namespace RTMP
 {
+    class Transport;
+
     struct Session
     {
         /** 
          * Handshake
+         *
+         * The handshake data only lives until the handshake is done.
          **/
-        Handshake::Handshake handshake;
+        Handshake::State handshakeState = Handshake::State::Uninitialized;
+        unique_ptr<Handshake::Handshake> handshake;
 
         /** 
          * Last chunk
          **/
         Chunk* lastChunk = nullptr;
-        vector<unsigned char> remainingBytes;
 
-        Netconnection::Command* pendingCommand;
+        /**
+         * Receiving
+         *
+         * Bytes read from the socket and not yet consumed by the parser.
+         * pendingBytes is the amount the parser needs before it can make
+         * progress again; parsing is skipped until it is reached.
+         **/
+        RingBuffer receiveBuffer;
+        size_t pendingBytes = 0;
+
+        // Linear copy of a payload that wraps around the ring buffer.
+        vector<unsigned char> payloadScratch;
+
+        /**
+         * Header state of every chunk stream received on this session.
+         **/
+        ChunkStreamTable chunkStreams;
+
+        /**
+         * Header state of every chunk stream sent on this session, used to
+         * pick the smallest header that describes the next message.
+         **/
+        ChunkStreamTable outChunkStreams;
+
+        /**
+         * Maximum chunk payload size announced by the peer (Set Chunk Size).
+         **/
+        unsigned int inChunkSize = 128;
+
+        /**
+         * Maximum chunk payload size of the chunks sent to the peer, as announced to it.
+         **/
+        unsigned int outChunkSize = 128;
+
+        /**
+         * Pool of the buffers messages are reassembled in.
+         **/
+        BufferPool* bufferPool = &BufferPool::Default();
+
+        /**
+         * Bytes reserved by the messages being reassembled on every chunk
+         * stream. The session is closed rather than go past the maximum:
+         * two of the largest messages.
+         **/
+        static constexpr size_t MaximumPartialBytes = 32 * 1024 * 1024;
+        size_t partialBytes = 0;
+
+        /**
+         * Command being handled, and the arena it is decoded in.
+         **/
+        const AMF0Command* pendingCommand = nullptr;
+        AMF0Arena commandArena;
+
+        /**
+         * Encoding negotiated on connect.
+         **/
+        Netconnection::ObjectEncoding objectEncoding = Netconnection::ObjectEncoding::AMF0;
 
         /**
          * Handling
          **/
         SOCKET socket = INVALID_SOCKET;
 
+        /**
+         * Sending
+         *
+         * Everything sent during a loop turn is queued, the transport writes
+         * the queue once at the end of the turn (sendScheduled).
+         * closing is set when the connection must be torn down.
+         **/
+        OutboundQueue outbound;
+        bool sendScheduled = false;
+        bool closing = false;
+
+        // Backend the session was accepted on.
+        Transport* transport = nullptr;
+
+        /**
+         * Live streams
+         *
+         * Stream this session publishes to, and stream it plays.
+         **/
+        shared_ptr<LiveStream> publishing;
+        shared_ptr<LiveStream> playing;
+
+        // File the published stream is written to, for the record and append types.
+        shared_ptr<Recording> recording;
+
+        // File played, for recorded streams.
+        VodPlayback vod;
+
+        /**
+         * Backlog allowed for the media played, and what was dropped to stay in it.
+         **/
+        EgressBudget egress;
+        EgressMetrics metrics;
+
         int streamID = 0;
 
         int timestamps = 0;
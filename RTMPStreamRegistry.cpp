@@ -0,0 +1,145 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the live stream registry.
+ **/
+
+#include "RTMPStreamRegistry.hpp"
+
+namespace RTMP
+{
+    static atomic<size_t> ReaderCount { 0 };
+
+    StreamRegistry::StreamRegistry()
+    {
+        current.store(new Map);
+    }
+
+    StreamRegistry::~StreamRegistry()
+    {
+        for (Retired& entry : retired)
+            delete entry.map;
+        delete current.load();
+    }
+
+    size_t StreamRegistry::ReaderIndex()
+    {
+        // Assigned once per thread, shared by every registry.
+        static thread_local size_t index = ReaderCount.fetch_add(1, memory_order_relaxed);
+        return index;
+    }
+
+    shared_ptr<LiveStream> StreamRegistry::Find(const string& name)
+    {
+        size_t index = ReaderIndex();
+        if (index >= MaximumReaders)
+        {
+            lock_guard<mutex> guard(writer);
+            const Map* map = current.load();
+            Map::const_iterator position = map->find(name);
+            return position == map->end() ? nullptr : position->second;
+        }
+
+        /**
+         * Announce the epoch before loading the map: a writer that retires
+         * the map afterwards sees this reader and keeps the map.
+         **/
+        Reader& reader = readers[index];
+        reader.epoch.store(epoch.load(memory_order_seq_cst), memory_order_seq_cst);
+
+        const Map* map = current.load(memory_order_seq_cst);
+        Map::const_iterator position = map->find(name);
+        shared_ptr<LiveStream> stream = position == map->end() ? nullptr : position->second;
+
+        reader.epoch.store(0, memory_order_release);
+        return stream;
+    }
+
+    shared_ptr<LiveStream> StreamRegistry::Publish(const string& name)
+    {
+        lock_guard<mutex> guard(writer);
+
+        const Map* map = current.load();
+        if (map->count(name))
+            return nullptr;
+
+        shared_ptr<LiveStream> stream = make_shared<LiveStream>(name);
+        if (aggregationWindow)
+            stream->SetAggregation(aggregationWindow, aggregationLimit);
+
+        Map* updated = new Map(*map);
+        updated->emplace(name, stream);
+        Replace(updated);
+        return stream;
+    }
+
+    void StreamRegistry::Unpublish(const LiveStream& stream)
+    {
+        lock_guard<mutex> guard(writer);
+
+        const Map* map = current.load();
+        Map::const_iterator position = map->find(stream.Name());
+        if (position == map->end() || position->second.get() != &stream)
+            return;
+
+        Map* updated = new Map(*map);
+        updated->erase(stream.Name());
+        Replace(updated);
+    }
+
+    void StreamRegistry::SetAggregation(unsigned int window, size_t largestMessage)
+    {
+        lock_guard<mutex> guard(writer);
+        aggregationWindow = window;
+        aggregationLimit = largestMessage;
+    }
+
+    size_t StreamRegistry::Count()
+    {
+        lock_guard<mutex> guard(writer);
+        return current.load()->size();
+    }
+
+    void StreamRegistry::Replace(Map* map)
+    {
+        const Map* previous = current.exchange(map, memory_order_seq_cst);
+
+        // Readers announcing a later epoch load the new map.
+        uint64_t retiredEpoch = epoch.fetch_add(1, memory_order_seq_cst);
+        retired.push_back(Retired { previous, retiredEpoch });
+
+        Reclaim();
+    }
+
+    void StreamRegistry::Reclaim()
+    {
+        // Oldest epoch a reader is still in.
+        uint64_t oldest = UINT64_MAX;
+        size_t count = ReaderCount.load(memory_order_relaxed);
+        if (count > MaximumReaders)
+            count = MaximumReaders;
+        for (size_t i = 0; i < count; i++)
+        {
+            uint64_t reading = readers[i].epoch.load(memory_order_seq_cst);
+            if (reading != 0 && reading < oldest)
+                oldest = reading;
+        }
+
+        size_t kept = 0;
+        for (Retired& entry : retired)
+        {
+            if (entry.epoch < oldest)
+                delete entry.map;
+            else
+                retired[kept++] = entry;
+        }
+        retired.resize(kept);
+    }
+
+    StreamRegistry& StreamRegistry::Default()
+    {
+        static StreamRegistry registry;
+        return registry;
+    }
+}
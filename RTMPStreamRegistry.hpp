@@ -0,0 +1,111 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Registry of the live streams being published.
+ **/
+
+#include "RTMPLiveStream.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Live streams by publishing name, shared by every thread.
+     *
+     * Lookups never lock: the names are held in an immutable map, replaced
+     * as a whole by publish and unpublish (copy on write, under a writer
+     * lock). A replaced map is freed once no reader that could have loaded
+     * it is still reading, which readers announce with the epoch they
+     * started in (epoch-based reclamation).
+     **/
+    class StreamRegistry
+    {
+        private:
+            typedef unordered_map<string, shared_ptr<LiveStream>> Map;
+
+            struct Retired
+            {
+                const Map* map;
+
+                // Readers that started before this epoch may still use the map.
+                uint64_t epoch;
+            };
+
+            /**
+             * Epoch each reading thread started in, 0 when not reading.
+             * Threads past MaximumReaders read under the writer lock.
+             **/
+            static constexpr size_t MaximumReaders = 256;
+
+            struct alignas(64) Reader
+            {
+                atomic<uint64_t> epoch { 0 };
+            };
+
+            Reader readers[MaximumReaders];
+
+            atomic<const Map*> current;
+            atomic<uint64_t> epoch { 1 };
+
+            mutex writer;
+            vector<Retired> retired;
+
+            // Egress aggregation of the streams created, under the writer lock.
+            unsigned int aggregationWindow = 0;
+            size_t aggregationLimit = 0;
+
+            static size_t ReaderIndex();
+
+            void Replace(Map* map);
+            void Reclaim();
+
+        public:
+            StreamRegistry();
+            ~StreamRegistry();
+
+            StreamRegistry(const StreamRegistry&) = delete;
+            StreamRegistry& operator=(const StreamRegistry&) = delete;
+
+            /**
+             * Stream published under `name`, or nullptr. May be called from any thread.
+             **/
+            shared_ptr<LiveStream> Find(const string& name);
+
+            /**
+             * Create the stream published under `name`.
+             * Returns nullptr if the name is already published.
+             **/
+            shared_ptr<LiveStream> Publish(const string& name);
+
+            /**
+             * Remove `stream` from the registry, if it is still the one
+             * published under its name. Its subscribers are detached by
+             * LiveStream::End.
+             **/
+            void Unpublish(const LiveStream& stream);
+
+            /**
+             * Aggregation of the streams published from now on
+             * (see LiveStream::SetAggregation).
+             **/
+            void SetAggregation(unsigned int window, size_t largestMessage);
+
+            size_t Count();
+
+            /**
+             * Registry used by the handler.
+             **/
+            static StreamRegistry& Default();
+    };
+}
@@ -0,0 +1,195 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the trace ring and its sink.
+ **/
+
+#include "RTMPTrace.hpp"
+
+#include <utils/FormatedPrint.hpp>
+
+#include <chrono>
+
+namespace RTMP
+{
+    namespace Trace
+    {
+        std::atomic<uint32_t> subsystemMask { All };
+
+        /**
+         * Bounded multi-producer, multi-consumer ring.
+         *
+         * Every cell carries a sequence number telling whether it is ready to be
+         * written or read for the current lap, so producers and consumers only
+         * contend on their own position counter.
+         **/
+        class Ring
+        {
+            private:
+                static constexpr size_t Capacity = 4096;
+
+                struct Cell
+                {
+                    std::atomic<size_t> sequence;
+                    Record record;
+                };
+
+                Cell cells[Capacity];
+
+                alignas(64) std::atomic<size_t> writePosition { 0 };
+                alignas(64) std::atomic<size_t> readPosition { 0 };
+
+            public:
+                alignas(64) std::atomic<uint64_t> dropped { 0 };
+
+                Ring()
+                {
+                    for (size_t i = 0; i < Capacity; i++)
+                        cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+
+                bool Push(const Record& record)
+                {
+                    size_t position = writePosition.load(std::memory_order_relaxed);
+                    for (;;)
+                    {
+                        Cell& cell = cells[position & (Capacity - 1)];
+                        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                        intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+                        if (difference == 0)
+                        {
+                            if (writePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                            {
+                                cell.record = record;
+                                cell.sequence.store(position + 1, std::memory_order_release);
+                                return true;
+                            }
+                        }
+                        else if (difference < 0)
+                        {
+                            // Full.
+                            return false;
+                        }
+                        else
+                        {
+                            position = writePosition.load(std::memory_order_relaxed);
+                        }
+                    }
+                }
+
+                bool Pop(Record& record)
+                {
+                    size_t position = readPosition.load(std::memory_order_relaxed);
+                    for (;;)
+                    {
+                        Cell& cell = cells[position & (Capacity - 1)];
+                        size_t sequence = cell.sequence.load(std::memory_order_acquire);
+                        intptr_t difference = (intptr_t)sequence - (intptr_t)(position + 1);
+
+                        if (difference == 0)
+                        {
+                            if (readPosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                            {
+                                record = cell.record;
+                                cell.sequence.store(position + Capacity, std::memory_order_release);
+                                return true;
+                            }
+                        }
+                        else if (difference < 0)
+                        {
+                            // Empty.
+                            return false;
+                        }
+                        else
+                        {
+                            position = readPosition.load(std::memory_order_relaxed);
+                        }
+                    }
+                }
+        };
+
+        static Ring& Instance()
+        {
+            static Ring ring;
+            return ring;
+        }
+
+        static void DefaultSink(const Record& record, const std::string& message)
+        {
+            if (record.level >= Error)
+                Utils::FormatedPrint::PrintError(record.scope, message);
+            else
+                Utils::FormatedPrint::PrintFormated(record.scope, message);
+        }
+
+        static std::atomic<Sink> sink { DefaultSink };
+
+        /**
+         * Replace every "{}" of the format with the next argument.
+         **/
+        static std::string Format(const Record& record)
+        {
+            std::string message;
+            size_t argument = 0;
+
+            for (const char* c = record.format; *c; c++)
+            {
+                if (c[0] == '{' && c[1] == '}' && argument < record.argumentCount)
+                {
+                    message += std::to_string(record.arguments[argument++]);
+                    c++;
+                }
+                else
+                {
+                    message += *c;
+                }
+            }
+            return message;
+        }
+
+        uint64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+
+        void Push(const Record& record)
+        {
+            Ring& ring = Instance();
+            if (!ring.Push(record))
+                ring.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        size_t Flush()
+        {
+            Ring& ring = Instance();
+            Sink output = sink.load(std::memory_order_relaxed);
+
+            size_t count = 0;
+            Record record;
+            while (ring.Pop(record))
+            {
+                output(record, Format(record));
+                count++;
+            }
+            return count;
+        }
+
+        void SetSink(Sink newSink)
+        {
+            sink.store(newSink != nullptr ? newSink : DefaultSink, std::memory_order_relaxed);
+        }
+
+        uint64_t Dropped()
+        {
+            return Instance().dropped.load(std::memory_order_relaxed);
+        }
+
+        void PrintBytes(const unsigned char* data, size_t length)
+        {
+            Utils::FormatedPrint::PrintBytes<unsigned char>(const_cast<unsigned char*>(data), (int)length);
+        }
+    }
+}
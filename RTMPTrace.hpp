@@ -0,0 +1,152 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Structured tracing.
+ *
+ * Trace points under RTMP_TRACE_LEVEL are removed at compile time, arguments
+ * included. Trace points that are compiled in are filtered at runtime by
+ * subsystem, then recorded in binary form (scope, format and integer
+ * arguments) in a lock-free ring. Formatting only happens when the ring is
+ * flushed, away from the per-message path.
+ *
+ * Usage:
+ *  RTMP_TRACE(Debug, Parser, "Parser::ParseChunks", "Chunk stream {}, {} bytes.", csid, length);
+ **/
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+
+/**
+ * Lowest trace level compiled in.
+ * 0: Verbose, 1: Debug, 2: Info, 3: Warning, 4: Error, 5: None.
+ **/
+#ifndef RTMP_TRACE_LEVEL
+#define RTMP_TRACE_LEVEL 2
+#endif
+
+namespace RTMP
+{
+    namespace Trace
+    {
+        enum Level : uint8_t
+        {
+            Verbose = 0,
+            Debug   = 1,
+            Info    = 2,
+            Warning = 3,
+            Error   = 4
+        };
+
+        enum Subsystem : uint32_t
+        {
+            Handshake   = 1 << 0,
+            Parser      = 1 << 1,
+            Handler     = 1 << 2,
+            Response    = 1 << 3,
+            Transport   = 1 << 4,
+
+            All         = 0xFFFFFFFF
+        };
+
+        static constexpr size_t MaximumArguments = 4;
+
+        /**
+         * Binary trace record. Scope and format must be string literals.
+         **/
+        struct Record
+        {
+            uint64_t time;
+            const char* scope;
+            const char* format;
+            int64_t arguments[MaximumArguments];
+            uint32_t subsystem;
+            uint8_t level;
+            uint8_t argumentCount;
+        };
+
+        /**
+         * Receives every flushed record, with its formatted message.
+         **/
+        typedef void (*Sink)(const Record&, const std::string& message);
+
+        /**
+         * Subsystems for which compiled-in trace points are recorded.
+         **/
+        extern std::atomic<uint32_t> subsystemMask;
+
+        inline bool Enabled(uint32_t subsystem)
+        {
+            return (subsystemMask.load(std::memory_order_relaxed) & subsystem) != 0;
+        }
+
+        inline void SetMask(uint32_t mask)
+        {
+            subsystemMask.store(mask, std::memory_order_relaxed);
+        }
+
+        uint64_t Now();
+
+        /**
+         * Append a record to the ring. Records are dropped when it is full.
+         **/
+        void Push(const Record& record);
+
+        template <typename... Arguments>
+        void Emit(Level level, Subsystem subsystem, const char* scope, const char* format, Arguments... arguments)
+        {
+            static_assert(sizeof...(Arguments) <= MaximumArguments, "Too many trace arguments.");
+            static_assert(((std::is_arithmetic<Arguments>::value || std::is_enum<Arguments>::value) && ...),
+                "Trace arguments are recorded in binary form and must be integers.");
+
+            Record record;
+            record.time = Now();
+            record.scope = scope;
+            record.format = format;
+            record.subsystem = subsystem;
+            record.level = level;
+            record.argumentCount = sizeof...(Arguments);
+
+            int64_t values[sizeof...(Arguments) + 1] = { static_cast<int64_t>(arguments)... };
+            for (size_t i = 0; i < sizeof...(Arguments); i++)
+                record.arguments[i] = values[i];
+
+            Push(record);
+        }
+
+        /**
+         * Format the recorded trace points and hand them to the sink,
+         * FormatedPrint by default. Returns the number of records flushed.
+         **/
+        size_t Flush();
+        void SetSink(Sink sink);
+
+        /**
+         * Records lost because the ring was full.
+         **/
+        uint64_t Dropped();
+
+        /**
+         * Synchronous byte dump, only compiled in at the Verbose level.
+         **/
+        void PrintBytes(const unsigned char* data, size_t length);
+    }
+}
+
+#define RTMP_TRACE(level, subsystem, scope, ...) \
+    do { \
+        if constexpr (::RTMP::Trace::level >= RTMP_TRACE_LEVEL) \
+            if (::RTMP::Trace::Enabled(::RTMP::Trace::subsystem)) \
+                ::RTMP::Trace::Emit(::RTMP::Trace::level, ::RTMP::Trace::subsystem, scope, __VA_ARGS__); \
+    } while (0)
+
+#define RTMP_TRACE_BYTES(subsystem, data, length) \
+    do { \
+        if constexpr (::RTMP::Trace::Verbose >= RTMP_TRACE_LEVEL) \
+            if (::RTMP::Trace::Enabled(::RTMP::Trace::subsystem)) \
+                ::RTMP::Trace::PrintBytes((const unsigned char*)(data), (size_t)(length)); \
+    } while (0)
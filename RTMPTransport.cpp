@@ -0,0 +1,224 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Transport backend selection.
+ **/
+
+#include "RTMPTransport.hpp"
+#include "RTMPTrace.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+
+#ifdef __linux__
+#include "RTMPReactor.hpp"
+#include "RTMPUring.hpp"
+
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+namespace RTMP
+{
+    int Transport::OpenListenSocket(unsigned short port, int backlog, bool reusePort)
+    {
+        #ifdef __linux__
+        int descriptor = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (descriptor < 0)
+            return -1;
+
+        int enable = 1;
+        int disable = 0;
+        setsockopt(descriptor, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+        if (reusePort)
+            setsockopt(descriptor, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+        // Accept IPv4 connections as well.
+        setsockopt(descriptor, IPPROTO_IPV6, IPV6_V6ONLY, &disable, sizeof(disable));
+
+        sockaddr_in6 address = {};
+        address.sin6_family = AF_INET6;
+        address.sin6_addr = in6addr_any;
+        address.sin6_port = htons(port);
+
+        if (bind(descriptor, (sockaddr*)&address, sizeof(address)) < 0 
+            || listen(descriptor, backlog) < 0)
+        {
+            RTMP_TRACE(Error, Transport,
+                "Transport::OpenListenSocket",
+                "Could not listen on port {}, errno {}.",
+                port, errno);
+            close(descriptor);
+            return -1;
+        }
+        return descriptor;
+        #else
+        return -1;
+        #endif
+    }
+
+    Transport::Transport()
+    {
+        #ifdef __linux__
+        reserveDescriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+        #endif
+    }
+
+    bool Transport::RefuseConnection(int listenDescriptor)
+    {
+        #ifdef __linux__
+        if (reserveDescriptor < 0)
+            return false;
+
+        close(reserveDescriptor);
+        int refused = accept4(listenDescriptor, nullptr, nullptr, SOCK_CLOEXEC);
+        if (refused >= 0)
+            close(refused);
+        reserveDescriptor = open("/dev/null", O_RDONLY | O_CLOEXEC);
+
+        return refused >= 0;
+        #else
+        return false;
+        #endif
+    }
+
+    Transport::~Transport()
+    {
+        #ifdef __linux__
+        if (reserveDescriptor >= 0)
+            close(reserveDescriptor);
+        #endif
+
+        // Tasks never run are dropped.
+        Task* task = inbox.exchange(nullptr, memory_order_acquire);
+        while (task != nullptr)
+        {
+            Task* next = task->next;
+            delete task;
+            task = next;
+        }
+    }
+
+    void Transport::Post(function<void()> run)
+    {
+        Task* task = new Task;
+        task->run = move(run);
+
+        Task* head = inbox.load(memory_order_relaxed);
+        do
+        {
+            task->next = head;
+        }
+        while (!inbox.compare_exchange_weak(head, task, memory_order_release, memory_order_relaxed));
+
+        // The loop drains the whole inbox once woken; only the first task wakes it.
+        if (head == nullptr)
+            Wake();
+    }
+
+    void Transport::RunPosted()
+    {
+        Task* task = inbox.exchange(nullptr, memory_order_acquire);
+
+        // Newest first: reverse to run them in posting order.
+        Task* ordered = nullptr;
+        while (task != nullptr)
+        {
+            Task* next = task->next;
+            task->next = ordered;
+            ordered = task;
+            task = next;
+        }
+
+        while (ordered != nullptr)
+        {
+            Task* next = ordered->next;
+            ordered->run();
+            delete ordered;
+            ordered = next;
+        }
+    }
+
+    static uint64_t Now()
+    {
+        return (uint64_t)chrono::duration_cast<chrono::milliseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    bool Transport::Later(const Timer& left, const Timer& right)
+    {
+        return left.deadline > right.deadline;
+    }
+
+    void Transport::After(unsigned int milliseconds, function<void()> task)
+    {
+        timers.push_back(Timer { Now() + milliseconds, move(task) });
+        push_heap(timers.begin(), timers.end(), Later);
+    }
+
+    int Transport::RunTimers()
+    {
+        while (!timers.empty())
+        {
+            uint64_t now = Now();
+            uint64_t deadline = timers.front().deadline;
+            if (deadline > now)
+                return deadline - now > INT_MAX ? INT_MAX : (int)(deadline - now);
+
+            // Taken off the heap first: the task may add timers.
+            pop_heap(timers.begin(), timers.end(), Later);
+            function<void()> run = move(timers.back().run);
+            timers.pop_back();
+            run();
+        }
+        return -1;
+    }
+
+    void Transport::Schedule(Session& session)
+    {
+        if (session.sendScheduled)
+            return;
+
+        session.sendScheduled = true;
+        scheduled.push_back(&session);
+    }
+
+    void Transport::Unschedule(Session& session)
+    {
+        if (!session.sendScheduled)
+            return;
+
+        for (Session*& entry : scheduled)
+        {
+            if (entry == &session)
+                entry = nullptr;
+        }
+        session.sendScheduled = false;
+    }
+
+    unique_ptr<Transport> Transport::Create(Backend backend)
+    {
+        #ifdef __linux__
+        if (backend == Backend::Uring)
+        {
+            unique_ptr<UringTransport> transport(new UringTransport);
+            if (transport->Valid())
+                return transport;
+
+            RTMP_TRACE(Warning, Transport,
+                "Transport::Create",
+                "io_uring is not available, using epoll.");
+        }
+        return unique_ptr<Transport>(new Reactor);
+        #else
+        RTMP_TRACE(Error, Transport,
+            "Transport::Create",
+            "No transport backend on this platform.");
+        return nullptr;
+        #endif
+    }
+}
@@ -0,0 +1,170 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Session transport interface.
+ **/
+
+#include "RTMPSession.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Socket I/O backend of a set of sessions.
+     *
+     * A transport accepts connections, feeds what it receives to the parser
+     * and writes what the handler sends. Every backend shares the session,
+     * parser and handler code; only the way bytes move differs.
+     **/
+    class Transport
+    {
+        private:
+            /**
+             * Task posted by another thread, run by the loop thread.
+             **/
+            struct Task
+            {
+                function<void()> run;
+                Task* next = nullptr;
+            };
+
+            // Lock-free stack of posted tasks, newest first.
+            atomic<Task*> inbox { nullptr };
+
+            /**
+             * Task run by the loop thread once its deadline, in steady clock
+             * milliseconds, passed. Kept in a min-heap on the deadline.
+             **/
+            struct Timer
+            {
+                uint64_t deadline;
+                function<void()> run;
+            };
+
+            vector<Timer> timers;
+
+            static bool Later(const Timer& left, const Timer& right);
+
+        protected:
+            BufferPool* bufferPool = &BufferPool::Default();
+            bool reusePort = false;
+
+            // Open sessions, readable from any thread.
+            atomic<size_t> sessionCount { 0 };
+
+            // Sessions to flush at the end of the loop turn; closed ones are nulled.
+            vector<Session*> scheduled;
+
+            void Unschedule(Session& session);
+
+            /**
+             * Interrupt the event loop wait. May be called from any thread.
+             **/
+            virtual void Wake() = 0;
+
+            /**
+             * Run the tasks posted since the last call, in the order they were posted.
+             **/
+            void RunPosted();
+
+            /**
+             * Run the timers that expired. Returns the milliseconds until the
+             * next one is due, or -1 when there is none: the loop's wait timeout.
+             **/
+            int RunTimers();
+
+            /**
+             * Open a non-blocking socket listening on `port`, IPv4 and IPv6.
+             * Returns the descriptor, or -1 on failure.
+             **/
+            static int OpenListenSocket(unsigned short port, int backlog, bool reusePort);
+
+            /**
+             * Milliseconds before accepting again when the process or the
+             * kernel ran out of the resources a connection needs.
+             **/
+            static constexpr unsigned int AcceptRetryDelay = 100;
+
+            /**
+             * Out of descriptors, a pending connection cannot be accepted and
+             * stays pending: it is accepted with the descriptor kept in
+             * reserve and closed at once. Returns whether one was closed.
+             **/
+            bool RefuseConnection(int listenDescriptor);
+
+        private:
+            // Held open to be given up for RefuseConnection.
+            int reserveDescriptor = -1;
+
+        public:
+            enum class Backend
+            {
+                Epoll,
+                Uring
+            };
+
+            Transport();
+            virtual ~Transport();
+
+            /**
+             * Pool the messages of accepted sessions are reassembled in.
+             **/
+            void SetBufferPool(BufferPool* pool) { bufferPool = pool; }
+
+            /**
+             * Let several transports listen on the same port (SO_REUSEPORT);
+             * the kernel spreads connections between them. Set before Listen().
+             **/
+            void SetReusePort(bool enable) { reusePort = enable; }
+
+            /**
+             * Listen for connections on `port`. Returns 0, or -1 on failure.
+             **/
+            virtual int Listen(unsigned short port, int backlog = 1024) = 0;
+
+            /**
+             * Run the event loop until Stop() is called.
+             **/
+            virtual int Run() = 0;
+
+            /**
+             * Ask the event loop to return. May be called from any thread.
+             **/
+            virtual void Stop() = 0;
+
+            size_t SessionCount() const { return sessionCount.load(memory_order_relaxed); }
+
+            /**
+             * Write the session's outbound queue at the end of the loop turn.
+             **/
+            void Schedule(Session& session);
+
+            /**
+             * Run `task` on the loop thread during its next loop turn, to reach
+             * sessions of this transport from another thread. May be called
+             * from any thread.
+             **/
+            void Post(function<void()> task);
+
+            /**
+             * Run `task` on the loop thread once `milliseconds` passed.
+             * Only called from the loop thread.
+             **/
+            void After(unsigned int milliseconds, function<void()> task);
+
+            /**
+             * Create the requested backend. Falls back to epoll when
+             * io_uring is not available on the running kernel.
+             **/
+            static unique_ptr<Transport> Create(Backend backend);
+    };
+}
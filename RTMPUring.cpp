@@ -0,0 +1,638 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of the io_uring transport.
+ **/
+
+#include "RTMPUring.hpp"
+#include "RTMPParser.hpp"
+#include "RTMPHandler.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+namespace RTMP
+{
+    /**
+     * Session with the state of its operations in flight.
+     **/
+    struct UringTransport::Connection : Session
+    {
+        // Operations whose last completion has not been reaped yet.
+        unsigned pending = 0;
+
+        // The socket was shut down; deleted once nothing is pending.
+        bool released = false;
+
+        /**
+         * Gathered send in flight, over the front of the outbound queue.
+         * Data queued meanwhile waits for its completion.
+         **/
+        bool sending = false;
+        iovec vectors[MaximumSlices];
+        msghdr message;
+    };
+
+    static uint64_t Encode(void* pointer, uint64_t operation)
+    {
+        return reinterpret_cast<uint64_t>(pointer) | operation;
+    }
+
+    UringTransport::UringTransport()
+    {
+        io_uring_params params = {};
+        params.flags = IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+
+        ringDescriptor = (int)syscall(__NR_io_uring_setup, Entries, &params);
+        if (ringDescriptor < 0 && errno == EINVAL)
+        {
+            params = {};
+            ringDescriptor = (int)syscall(__NR_io_uring_setup, Entries, &params);
+        }
+        if (ringDescriptor < 0)
+            return;
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_NODROP)
+            || !(params.features & IORING_FEAT_EXT_ARG))
+            return;
+
+        /**
+         * Submission and completion rings share one mapping.
+         **/
+        size_t submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        size_t completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        ringMemorySize = submissionRingSize > completionRingSize ? submissionRingSize : completionRingSize;
+
+        ringMemory = mmap(nullptr, ringMemorySize, PROT_READ | PROT_WRITE, 
+            MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQ_RING);
+        if (ringMemory == MAP_FAILED)
+        {
+            ringMemory = nullptr;
+            return;
+        }
+
+        submissionsSize = params.sq_entries * sizeof(io_uring_sqe);
+        void* submissionMemory = mmap(nullptr, submissionsSize, PROT_READ | PROT_WRITE, 
+            MAP_SHARED | MAP_POPULATE, ringDescriptor, IORING_OFF_SQES);
+        if (submissionMemory == MAP_FAILED)
+            return;
+        submissions = static_cast<io_uring_sqe*>(submissionMemory);
+
+        unsigned char* ring = static_cast<unsigned char*>(ringMemory);
+
+        submissionHead = reinterpret_cast<unsigned*>(ring + params.sq_off.head);
+        submissionTail = reinterpret_cast<unsigned*>(ring + params.sq_off.tail);
+        submissionMask = *reinterpret_cast<unsigned*>(ring + params.sq_off.ring_mask);
+        submissionEntries = params.sq_entries;
+        localSubmissionTail = *submissionTail;
+
+        // Submission slots map one to one to their entries.
+        unsigned* submissionArray = reinterpret_cast<unsigned*>(ring + params.sq_off.array);
+        for (unsigned i = 0; i < submissionEntries; i++)
+            submissionArray[i] = i;
+
+        completionHead = reinterpret_cast<unsigned*>(ring + params.cq_off.head);
+        completionTail = reinterpret_cast<unsigned*>(ring + params.cq_off.tail);
+        completionMask = *reinterpret_cast<unsigned*>(ring + params.cq_off.ring_mask);
+        completions = reinterpret_cast<io_uring_cqe*>(ring + params.cq_off.cqes);
+
+        wakeDescriptor = eventfd(0, EFD_CLOEXEC);
+        if (wakeDescriptor < 0)
+            return;
+
+        /**
+         * Provided buffer ring.
+         **/
+        size_t bufferRingSize = BufferCount * sizeof(io_uring_buf);
+        void* bufferRingMemory = mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, 
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (bufferRingMemory == MAP_FAILED)
+            return;
+
+        io_uring_buf_reg registration = {};
+        registration.ring_addr = reinterpret_cast<uint64_t>(bufferRingMemory);
+        registration.ring_entries = BufferCount;
+        registration.bgid = BufferGroup;
+
+        if (syscall(__NR_io_uring_register, ringDescriptor, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+        {
+            munmap(bufferRingMemory, bufferRingSize);
+            return;
+        }
+
+        bufferRing = static_cast<io_uring_buf_ring*>(bufferRingMemory);
+        bufferStorage = new unsigned char[(size_t)BufferCount * BufferSize];
+
+        for (unsigned id = 0; id < BufferCount; id++)
+            RecycleBuffer((uint16_t)id);
+        PublishBuffers();
+    }
+
+    UringTransport::~UringTransport()
+    {
+        /**
+         * The kernel may still write into the receive buffers and read the
+         * send vectors of the operations in flight, even past the close of
+         * the ring: they are cancelled and reaped before anything is freed.
+         * If that fails, the memory is leaked rather than reused under them.
+         **/
+        bool drained = Drain();
+
+        if (ringDescriptor >= 0)
+            close(ringDescriptor);
+
+        if (drained)
+        {
+            for (Connection* connection : connections)
+            {
+                Handler::CloseSession(*connection);
+                close(connection->socket);
+                delete connection;
+            }
+            connections.clear();
+
+            if (bufferRing)
+                munmap(bufferRing, BufferCount * sizeof(io_uring_buf));
+            delete[] bufferStorage;
+
+            if (submissions)
+                munmap(submissions, submissionsSize);
+            if (ringMemory)
+                munmap(ringMemory, ringMemorySize);
+        }
+
+        if (listenDescriptor >= 0)
+            close(listenDescriptor);
+        if (wakeDescriptor >= 0)
+            close(wakeDescriptor);
+    }
+
+    int UringTransport::Listen(unsigned short port, int backlog)
+    {
+        listenDescriptor = OpenListenSocket(port, backlog, reusePort);
+        if (listenDescriptor < 0)
+            return -1;
+
+        PrepareAccept();
+        return 0;
+    }
+
+    int UringTransport::Run()
+    {
+        PrepareWake();
+
+        // Sessions acquire from the pool on this thread only.
+        bufferPool->BindToCurrentThread();
+
+        while (!stopping)
+        {
+            RunPosted();
+            int timeout = RunTimers();
+            FlushSends();
+
+            if (Enter(1, timeout) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN && errno != ETIME)
+                return -1;
+
+            Reap();
+            Trace::Flush();
+        }
+
+        return 0;
+    }
+
+    void UringTransport::Stop()
+    {
+        stopping = true;
+        Wake();
+    }
+
+    void UringTransport::Wake()
+    {
+        uint64_t value = 1;
+        ssize_t written = write(wakeDescriptor, &value, sizeof(value));
+        (void)written;
+    }
+
+    /**
+     * Submission queue.
+     **/
+
+    io_uring_sqe* UringTransport::GetSubmission()
+    {
+        unsigned head = __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+        if (localSubmissionTail - head >= submissionEntries)
+        {
+            // Full: hand the entries to the kernel first.
+            Enter(0);
+            head = __atomic_load_n(submissionHead, __ATOMIC_ACQUIRE);
+        }
+
+        io_uring_sqe* submission = &submissions[localSubmissionTail & submissionMask];
+        memset(submission, 0, sizeof(io_uring_sqe));
+
+        localSubmissionTail++;
+        unsubmitted++;
+        inFlight++;
+        return submission;
+    }
+
+    int UringTransport::Enter(unsigned minimumCompletions, int timeout)
+    {
+        __atomic_store_n(submissionTail, localSubmissionTail, __ATOMIC_RELEASE);
+
+        unsigned flags = minimumCompletions ? IORING_ENTER_GETEVENTS : 0;
+
+        // The wait ends with ETIME past the timeout, in milliseconds.
+        __kernel_timespec limit = {};
+        io_uring_getevents_arg argument = {};
+        void* extended = nullptr;
+        size_t extendedSize = 0;
+        if (minimumCompletions && timeout >= 0)
+        {
+            limit.tv_sec = timeout / 1000;
+            limit.tv_nsec = (long long)(timeout % 1000) * 1000000;
+            argument.ts = reinterpret_cast<uint64_t>(&limit);
+            flags |= IORING_ENTER_EXT_ARG;
+            extended = &argument;
+            extendedSize = sizeof(argument);
+        }
+
+        int result = (int)syscall(__NR_io_uring_enter, ringDescriptor, unsubmitted, minimumCompletions, flags, extended, extendedSize);
+        if (result > 0)
+            unsubmitted -= result;
+        return result;
+    }
+
+    void UringTransport::Reap()
+    {
+        unsigned head = *completionHead;
+        unsigned tail = __atomic_load_n(completionTail, __ATOMIC_ACQUIRE);
+
+        while (head != tail)
+        {
+            io_uring_cqe completion = completions[head & completionMask];
+            head++;
+            __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+
+            if (!(completion.flags & IORING_CQE_F_MORE))
+                inFlight--;
+            Complete(completion);
+        }
+
+        PublishBuffers();
+
+        /**
+         * Buffers were recycled above; receive again on the connections
+         * that ran out.
+         **/
+        for (size_t i = 0; i < starved.size(); i++)
+        {
+            Connection& connection = *starved[i];
+            connection.pending--;
+
+            if (connection.closing)
+                Release(connection);
+            else
+                PrepareReceive(connection);
+        }
+        starved.clear();
+    }
+
+    /**
+     * Cancel every operation in flight and reap their completions, without
+     * handling them. Returns false if the ring failed before they all ended.
+     **/
+    bool UringTransport::Drain()
+    {
+        if (inFlight == 0)
+            return true;
+
+        // Receives and blocked sends complete once their socket is shut down.
+        for (Connection* connection : connections)
+            shutdown(connection->socket, SHUT_RDWR);
+
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_ASYNC_CANCEL;
+        submission->fd = -1;
+        submission->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+        submission->user_data = Encode(nullptr, (uint64_t)Operation::Wake);
+
+        while (inFlight > 0)
+        {
+            if (Enter(1) < 0 && errno != EINTR && errno != EBUSY && errno != EAGAIN)
+            {
+                RTMP_TRACE(Error, Transport,
+                    "UringTransport::Drain",
+                    "{} operations left in flight, errno {}.",
+                    inFlight, errno);
+                return false;
+            }
+
+            unsigned head = *completionHead;
+            unsigned tail = __atomic_load_n(completionTail, __ATOMIC_ACQUIRE);
+            for (; head != tail; head++)
+            {
+                if (!(completions[head & completionMask].flags & IORING_CQE_F_MORE))
+                    inFlight--;
+            }
+            __atomic_store_n(completionHead, head, __ATOMIC_RELEASE);
+        }
+        return true;
+    }
+
+    /**
+     * Provided buffers.
+     **/
+
+    void UringTransport::RecycleBuffer(uint16_t id)
+    {
+        io_uring_buf& buffer = bufferRing->bufs[bufferTail & (BufferCount - 1)];
+        buffer.addr = reinterpret_cast<uint64_t>(bufferStorage + (size_t)id * BufferSize);
+        buffer.len = BufferSize;
+        buffer.bid = id;
+        bufferTail++;
+    }
+
+    void UringTransport::PublishBuffers()
+    {
+        __atomic_store_n(&bufferRing->tail, bufferTail, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Operations.
+     **/
+
+    void UringTransport::PrepareAccept()
+    {
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_ACCEPT;
+        submission->fd = listenDescriptor;
+        submission->ioprio = IORING_ACCEPT_MULTISHOT;
+        submission->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+        submission->user_data = Encode(nullptr, (uint64_t)Operation::Accept);
+    }
+
+    void UringTransport::PrepareWake()
+    {
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_READ;
+        submission->fd = wakeDescriptor;
+        submission->addr = reinterpret_cast<uint64_t>(&wakeValue);
+        submission->len = sizeof(wakeValue);
+        submission->user_data = Encode(nullptr, (uint64_t)Operation::Wake);
+    }
+
+    void UringTransport::PrepareReceive(Connection& connection)
+    {
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_RECV;
+        submission->fd = connection.socket;
+        submission->ioprio = IORING_RECV_MULTISHOT;
+        submission->flags = IOSQE_BUFFER_SELECT;
+        submission->buf_group = BufferGroup;
+        submission->user_data = Encode(&connection, (uint64_t)Operation::Receive);
+        connection.pending++;
+    }
+
+    void UringTransport::PrepareSend(Connection& connection)
+    {
+        Slice slices[MaximumSlices];
+        size_t count = connection.outbound.Gather(slices, MaximumSlices);
+        for (size_t i = 0; i < count; i++)
+        {
+            connection.vectors[i].iov_base = const_cast<unsigned char*>(slices[i].data);
+            connection.vectors[i].iov_len = slices[i].length;
+        }
+
+        connection.message = {};
+        connection.message.msg_iov = connection.vectors;
+        connection.message.msg_iovlen = count;
+
+        io_uring_sqe* submission = GetSubmission();
+        submission->opcode = IORING_OP_SENDMSG;
+        submission->fd = connection.socket;
+        submission->addr = reinterpret_cast<uint64_t>(&connection.message);
+        submission->len = 1;
+        submission->msg_flags = MSG_NOSIGNAL;
+        submission->user_data = Encode(&connection, (uint64_t)Operation::Send);
+        connection.sending = true;
+        connection.pending++;
+    }
+
+    void UringTransport::FlushSends()
+    {
+        for (Session* session : scheduled)
+        {
+            if (session == nullptr)
+                continue;
+            session->sendScheduled = false;
+
+            // Every session of this transport is one of its connections.
+            Connection& connection = static_cast<Connection&>(*session);
+
+            // Marked closing outside of its own completions.
+            if (connection.closing)
+            {
+                Release(connection);
+                continue;
+            }
+
+            // One send in flight per connection; the next starts on its completion.
+            if (connection.released || connection.sending || connection.outbound.Empty())
+                continue;
+
+            PrepareSend(connection);
+        }
+        scheduled.clear();
+    }
+
+    /**
+     * Completions.
+     **/
+
+    void UringTransport::Complete(const io_uring_cqe& completion)
+    {
+        Operation operation = (Operation)(completion.user_data & 3);
+        Connection* connection = reinterpret_cast<Connection*>(completion.user_data & ~(uint64_t)3);
+
+        switch (operation)
+        {
+            case Operation::Accept:
+                OnAccept(completion);
+                return;
+
+            case Operation::Wake:
+                if (!stopping)
+                    PrepareWake();
+                return;
+
+            case Operation::Receive:
+                OnReceive(*connection, completion);
+                break;
+
+            case Operation::Send:
+                OnSend(*connection, completion);
+                break;
+        }
+
+        if (connection->closing)
+            Release(*connection);
+    }
+
+    void UringTransport::OnAccept(const io_uring_cqe& completion)
+    {
+        if (completion.res >= 0)
+        {
+            int enable = 1;
+            setsockopt(completion.res, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+            Connection* connection = new Connection;
+            connection->socket = completion.res;
+            connection->transport = this;
+            connection->bufferPool = bufferPool;
+            connections.insert(connection);
+            sessionCount++;
+
+            PrepareReceive(*connection);
+
+            RTMP_TRACE(Debug, Transport,
+                "UringTransport::OnAccept",
+                "Session accepted on socket {}.",
+                completion.res);
+        }
+
+        if (completion.flags & IORING_CQE_F_MORE)
+            return;
+
+        // The multishot accept ended; arm it again unless the kernel refuses it.
+        if (completion.res == -EINVAL || completion.res == -EBADF)
+        {
+            RTMP_TRACE(Error, Transport,
+                "UringTransport::OnAccept",
+                "Accept failed, errno {}.",
+                -completion.res);
+            return;
+        }
+
+        /**
+         * Out of resources, the connection stays pending and an accept armed
+         * right away fails at once again. Past the descriptor limit it is
+         * refused; otherwise, accepting is retried later.
+         **/
+        if (completion.res == -EMFILE || completion.res == -ENFILE
+            || completion.res == -ENOBUFS || completion.res == -ENOMEM)
+        {
+            RTMP_TRACE(Error, Transport,
+                "UringTransport::OnAccept",
+                "Accept failed, errno {}.",
+                -completion.res);
+
+            if (completion.res == -ENOBUFS || completion.res == -ENOMEM || !RefuseConnection(listenDescriptor))
+            {
+                After(AcceptRetryDelay, [this]() {
+                    PrepareAccept();
+                });
+                return;
+            }
+        }
+        PrepareAccept();
+    }
+
+    void UringTransport::OnReceive(Connection& connection, const io_uring_cqe& completion)
+    {
+        if (completion.flags & IORING_CQE_F_BUFFER)
+        {
+            uint16_t id = (uint16_t)(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+            // Past a protocol error nothing is parsed any more: dropped.
+            if (completion.res > 0 && !connection.closing)
+                connection.receiveBuffer.Write(bufferStorage + (size_t)id * BufferSize, completion.res);
+            RecycleBuffer(id);
+        }
+
+        if (completion.res > 0 && !connection.released && !connection.closing)
+        {
+            connection.totalBytes += completion.res;
+            Parser::ParseBuffered(connection);
+
+            // Left unconsumed, more than the largest legal chunk.
+            if (connection.receiveBuffer.Size() > Parser::MaximumBuffered(connection))
+            {
+                RTMP_TRACE(Error, Transport,
+                    "UringTransport::OnReceive",
+                    "Chunk larger than {} bytes.",
+                    Parser::MaximumBuffered(connection));
+                connection.closing = true;
+            }
+        }
+
+        if (completion.flags & IORING_CQE_F_MORE)
+            return;
+
+        // Out of provided buffers: still counted as pending until armed again.
+        if (completion.res == -ENOBUFS)
+        {
+            starved.push_back(&connection);
+            return;
+        }
+
+        connection.pending--;
+
+        if (completion.res <= 0)
+            connection.closing = true;
+        else if (!connection.closing)
+            PrepareReceive(connection);
+    }
+
+    void UringTransport::OnSend(Connection& connection, const io_uring_cqe& completion)
+    {
+        connection.pending--;
+        connection.sending = false;
+
+        if (completion.res < 0)
+        {
+            connection.closing = true;
+            return;
+        }
+
+        // Partially written, or more was queued meanwhile.
+        connection.outbound.Consume(completion.res);
+        if (connection.outbound.Empty() && !connection.closing)
+            Handler::HandleDrained(connection);
+        if (!connection.outbound.Empty())
+            Schedule(connection);
+    }
+
+    void UringTransport::Release(Connection& connection)
+    {
+        if (!connection.released)
+        {
+            RTMP_TRACE(Debug, Transport,
+                "UringTransport::Release",
+                "Closing session on socket {}.",
+                connection.socket);
+
+            // Completes the pending receive and sends.
+            shutdown(connection.socket, SHUT_RDWR);
+            connection.released = true;
+        }
+
+        if (connection.pending > 0)
+            return;
+
+        close(connection.socket);
+        connections.erase(&connection);
+        sessionCount--;
+
+        Unschedule(connection);
+        Handler::CloseSession(connection);
+        delete &connection;
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Linux io_uring transport.
+ **/
+
+#include "RTMPTransport.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include <linux/io_uring.h>
+
+using namespace std;
+
+namespace RTMP
+{
+    /**
+     * Completion-based transport on io_uring.
+     *
+     * One multishot accept produces every new connection and one multishot
+     * receive per connection produces its data, picked from a ring of
+     * kernel-provided buffers. Received bytes are appended to the session's
+     * receive buffer and the provided buffer goes straight back to the kernel.
+     * Outbound queues filled while handling completions are written with one
+     * gathered sendmsg each, submitted together with the next wait, so a loop
+     * turn costs a single io_uring_enter.
+     *
+     * Requires Linux 6.0 or later.
+     **/
+    class UringTransport : public Transport
+    {
+        private:
+            struct Connection;
+
+            enum class Operation : uint64_t
+            {
+                Accept  = 0,
+                Wake    = 1,
+                Receive = 2,
+                Send    = 3
+            };
+
+            static constexpr unsigned Entries = 4096;
+
+            static constexpr unsigned BufferCount = 1024;
+            static constexpr unsigned BufferSize = 16 * 1024;
+            static constexpr uint16_t BufferGroup = 0;
+
+            // Slices written by one sendmsg.
+            static constexpr size_t MaximumSlices = 64;
+
+            int ringDescriptor = -1;
+            int listenDescriptor = -1;
+            int wakeDescriptor = -1;
+
+            /**
+             * Rings shared with the kernel.
+             **/
+            void* ringMemory = nullptr;
+            size_t ringMemorySize = 0;
+            io_uring_sqe* submissions = nullptr;
+            size_t submissionsSize = 0;
+
+            unsigned* submissionHead = nullptr;
+            unsigned* submissionTail = nullptr;
+            unsigned submissionMask = 0;
+            unsigned submissionEntries = 0;
+            unsigned localSubmissionTail = 0;
+            unsigned unsubmitted = 0;
+
+            // Operations submitted whose last completion was not reaped yet.
+            unsigned inFlight = 0;
+
+            unsigned* completionHead = nullptr;
+            unsigned* completionTail = nullptr;
+            unsigned completionMask = 0;
+            io_uring_cqe* completions = nullptr;
+
+            /**
+             * Provided receive buffers.
+             **/
+            io_uring_buf_ring* bufferRing = nullptr;
+            unsigned char* bufferStorage = nullptr;
+            uint16_t bufferTail = 0;
+
+            uint64_t wakeValue = 0;
+            // Set by Stop(), possibly before Run() started.
+            atomic<bool> stopping { false };
+
+            unordered_set<Connection*> connections;
+
+            // Connections whose receive ran out of provided buffers.
+            vector<Connection*> starved;
+
+            io_uring_sqe* GetSubmission();
+            int Enter(unsigned minimumCompletions, int timeout = -1);
+            void Reap();
+            bool Drain();
+
+            void RecycleBuffer(uint16_t id);
+            void PublishBuffers();
+
+            void PrepareAccept();
+            void PrepareWake();
+            void PrepareReceive(Connection& connection);
+            void PrepareSend(Connection& connection);
+            void FlushSends();
+
+            void Complete(const io_uring_cqe& completion);
+            void OnAccept(const io_uring_cqe& completion);
+            void OnReceive(Connection& connection, const io_uring_cqe& completion);
+            void OnSend(Connection& connection, const io_uring_cqe& completion);
+            void Release(Connection& connection);
+
+        protected:
+            void Wake() override;
+
+        public:
+            UringTransport();
+            ~UringTransport() override;
+
+            UringTransport(const UringTransport&) = delete;
+            UringTransport& operator=(const UringTransport&) = delete;
+
+            /**
+             * Whether the ring and its buffers could be set up.
+             **/
+            bool Valid() const { return bufferRing != nullptr; }
+
+            int Listen(unsigned short port, int backlog = 1024) override;
+            int Run() override;
+            void Stop() override;
+    };
+}
@@ -0,0 +1,332 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Implementation of video on demand.
+ **/
+
+#include "RTMPVod.hpp"
+#include "RTMPEndian.hpp"
+#include "RTMPMedia.hpp"
+#include "RTMPMessage.hpp"
+#include "RTMPRecorder.hpp"
+#include "RTMPTrace.hpp"
+#include "RTMPTransport.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+namespace RTMP
+{
+    static const char IndexMagic[8] = { 'R', 'T', 'M', 'P', 'V', 'O', 'D', '1' };
+
+    static bool ParseTag(const unsigned char* data, size_t size, uint64_t position, VodTag& tag)
+    {
+        if (position > size || size - position < 11)
+            return false;
+
+        const unsigned char* header = data + position;
+        size_t length = Endian::Load24BE(header + 1);
+        if (size - position - 11 < length)
+            return false;
+
+        // The low 5 bits are the type, above is the (unused) filter flag.
+        tag.type = header[0] & 0x1F;
+        tag.timestamp = Endian::Load24BE(header + 4) | ((unsigned int)header[7] << 24);
+        tag.data = header + 11;
+        tag.length = length;
+        tag.next = position + 11 + length + 4;
+        return true;
+    }
+
+    VodFile::~VodFile()
+    {
+        #ifndef _WIN32
+        if (data != nullptr)
+            munmap(const_cast<unsigned char*>(data), size);
+        if (index != nullptr)
+            munmap(const_cast<unsigned char*>(index), indexSize);
+        #endif
+    }
+
+    shared_ptr<VodFile> VodFile::Map(const string& path)
+    {
+        #ifndef _WIN32
+        int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+            return nullptr;
+
+        struct stat status;
+        if (fstat(descriptor, &status) < 0 || status.st_size < 13)
+        {
+            close(descriptor);
+            return nullptr;
+        }
+
+        void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (mapping == MAP_FAILED)
+            return nullptr;
+
+        shared_ptr<VodFile> file = make_shared<VodFile>();
+        file->data = static_cast<const unsigned char*>(mapping);
+        file->size = (size_t)status.st_size;
+        file->device = (uint64_t)status.st_dev;
+        file->inode = (uint64_t)status.st_ino;
+
+        // FLV signature, then the header size; the first tag follows PreviousTagSize0.
+        if (memcmp(file->data, "FLV", 3) != 0)
+            return nullptr;
+        file->firstTag = (uint64_t)Endian::Load32BE(file->data + 5) + 4;
+        if (file->firstTag > file->size)
+            return nullptr;
+
+        file->modified = (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec;
+        file->MapIndex(path + ".idx", file->modified);
+        return file;
+        #else
+        return nullptr;
+        #endif
+    }
+
+    bool VodFile::Index(const string& path)
+    {
+        #ifndef _WIN32
+        // Indexed meanwhile, for an earlier play of the same file.
+        string indexPath = path + ".idx";
+        if (MapIndex(indexPath, modified))
+            return true;
+
+        RTMP_TRACE(Info, Handler,
+            "VodFile::Index",
+            "Indexing {} bytes.",
+            size);
+
+        vector<unsigned char> built = BuildIndex(modified);
+
+        /**
+         * Saved under a temporary name, then renamed over the index, so
+         * that a concurrent open never maps a partial file.
+         **/
+        static atomic<unsigned int> sequence { 0 };
+        string temporary = indexPath + "." + to_string(getpid()) + "." + to_string(sequence.fetch_add(1));
+        FILE* output = fopen(temporary.c_str(), "wb");
+        bool saved = output != nullptr && fwrite(built.data(), 1, built.size(), output) == built.size();
+        if (output != nullptr)
+            saved = fclose(output) == 0 && saved;
+        saved = saved && rename(temporary.c_str(), indexPath.c_str()) == 0;
+
+        if (saved && MapIndex(indexPath, modified))
+            return true;
+
+        // Not writable: the index lives as long as the file is played.
+        remove(temporary.c_str());
+        builtIndex = move(built);
+        return UseIndex(builtIndex.data(), builtIndex.size(), modified);
+        #else
+        return false;
+        #endif
+    }
+
+    bool VodFile::Matches(const string& path) const
+    {
+        #ifndef _WIN32
+        struct stat status;
+        if (stat(path.c_str(), &status) < 0)
+            return false;
+
+        return (uint64_t)status.st_dev == device && (uint64_t)status.st_ino == inode
+            && (size_t)status.st_size == size
+            && (int64_t)status.st_mtim.tv_sec * 1000000000 + status.st_mtim.tv_nsec == modified;
+        #else
+        return false;
+        #endif
+    }
+
+    bool VodFile::UseIndex(const unsigned char* bytes, size_t length, int64_t modified)
+    {
+        if (length < sizeof(VodIndexHeader))
+            return false;
+
+        const VodIndexHeader* candidate = reinterpret_cast<const VodIndexHeader*>(bytes);
+        if (memcmp(candidate->magic, IndexMagic, sizeof(IndexMagic)) != 0
+            || candidate->fileSize != size || candidate->modified != modified
+            || candidate->count != (length - sizeof(VodIndexHeader)) / sizeof(VodIndexEntry)
+            || (length - sizeof(VodIndexHeader)) % sizeof(VodIndexEntry) != 0)
+            return false;
+
+        header = candidate;
+        entries = reinterpret_cast<const VodIndexEntry*>(bytes + sizeof(VodIndexHeader));
+        return true;
+    }
+
+    bool VodFile::MapIndex(const string& path, int64_t modified)
+    {
+        #ifndef _WIN32
+        int descriptor = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (descriptor < 0)
+            return false;
+
+        struct stat status;
+        if (fstat(descriptor, &status) < 0 || status.st_size < (off_t)sizeof(VodIndexHeader))
+        {
+            close(descriptor);
+            return false;
+        }
+
+        void* mapping = mmap(nullptr, (size_t)status.st_size, PROT_READ, MAP_SHARED, descriptor, 0);
+        close(descriptor);
+        if (mapping == MAP_FAILED)
+            return false;
+
+        if (!UseIndex(static_cast<const unsigned char*>(mapping), (size_t)status.st_size, modified))
+        {
+            munmap(mapping, (size_t)status.st_size);
+            return false;
+        }
+
+        index = static_cast<const unsigned char*>(mapping);
+        indexSize = (size_t)status.st_size;
+        return true;
+        #else
+        return false;
+        #endif
+    }
+
+    vector<unsigned char> VodFile::BuildIndex(int64_t modified) const
+    {
+        VodIndexHeader built = {};
+        memcpy(built.magic, IndexMagic, sizeof(IndexMagic));
+        built.fileSize = size;
+        built.modified = modified;
+
+        vector<VodIndexEntry> keyframes;
+        VodTag tag;
+        for (uint64_t position = firstTag; ParseTag(data, size, position, tag); position = tag.next)
+        {
+            if (MediaMessage::IsSequenceHeader(tag.type, tag.data, tag.length))
+            {
+                uint64_t& first = tag.type == Message::Type::VideoMessage ? built.videoHeader : built.audioHeader;
+                if (first == 0)
+                    first = position;
+            }
+            else if (MediaMessage::IsKeyframe(tag.type, tag.data, tag.length))
+            {
+                // Kept in timestamp order: a timestamp going back is not a seek point.
+                if (keyframes.empty() || tag.timestamp >= keyframes.back().timestamp)
+                    keyframes.push_back(VodIndexEntry { tag.timestamp, 0, position });
+            }
+            else if (built.metadata == 0 && MediaMessage::IsMetadata(tag.type, tag.data, tag.length))
+            {
+                built.metadata = position;
+            }
+        }
+        built.count = keyframes.size();
+
+        vector<unsigned char> bytes(sizeof(VodIndexHeader) + keyframes.size() * sizeof(VodIndexEntry));
+        memcpy(bytes.data(), &built, sizeof(VodIndexHeader));
+        if (!keyframes.empty())
+            memcpy(bytes.data() + sizeof(VodIndexHeader), keyframes.data(), keyframes.size() * sizeof(VodIndexEntry));
+        return bytes;
+    }
+
+    bool VodFile::ReadTag(uint64_t position, VodTag& tag) const
+    {
+        return ParseTag(data, size, position, tag);
+    }
+
+    uint64_t VodFile::Seek(unsigned int milliseconds) const
+    {
+        // First keyframe past `milliseconds`, the one before is the answer.
+        size_t low = 0;
+        size_t high = (size_t)header->count;
+        while (low < high)
+        {
+            size_t middle = low + (high - low) / 2;
+            if (entries[middle].timestamp <= milliseconds)
+                low = middle + 1;
+            else
+                high = middle;
+        }
+        return low == 0 ? firstTag : entries[low - 1].position;
+    }
+
+    void VodLibrary::Open(const string& name, Transport& transport, function<void(shared_ptr<VodFile>)> ready)
+    {
+        string path = directory + "/" + Recorder::FileName(name);
+
+        shared_ptr<VodFile> cached;
+        {
+            lock_guard<mutex> guard(lock);
+            auto found = files.find(path);
+            if (found != files.end())
+                cached = found->second.lock();
+        }
+
+        // Replaced or grown since: mapped again, without holding the lock.
+        if (cached && cached->Matches(path))
+        {
+            ready(cached);
+            return;
+        }
+
+        shared_ptr<VodFile> file = VodFile::Map(path);
+        if (file == nullptr || file->Indexed())
+        {
+            ready(Share(path, file, cached));
+            return;
+        }
+
+        /**
+         * Indexing scans the whole file: done on the recorder's I/O thread,
+         * rather than holding up every session of the transport's thread.
+         **/
+        Transport* origin = &transport;
+        Recorder::Default().Run([this, path, file, cached, origin, ready]() {
+            shared_ptr<VodFile> indexed = file->Index(path) ? file : nullptr;
+            origin->Post([this, path, indexed, cached, ready]() {
+                ready(Share(path, indexed, cached));
+            });
+        });
+    }
+
+    shared_ptr<VodFile> VodLibrary::Share(const string& path, const shared_ptr<VodFile>& file, const shared_ptr<VodFile>& cached)
+    {
+        if (file == nullptr)
+            return nullptr;
+
+        lock_guard<mutex> guard(lock);
+
+        // Opened by another session meanwhile: share theirs.
+        weak_ptr<VodFile>& entry = files[path];
+        shared_ptr<VodFile> existing = entry.lock();
+        if (existing && existing != cached && existing->Matches(path))
+            return existing;
+        entry = file;
+
+        // Forget the files no longer played.
+        for (auto iterator = files.begin(); iterator != files.end();)
+        {
+            if (iterator->second.expired())
+                iterator = files.erase(iterator);
+            else
+                iterator++;
+        }
+        return file;
+    }
+
+    VodLibrary& VodLibrary::Default()
+    {
+        static VodLibrary library;
+        return library;
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Video on demand from FLV files.
+ **/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+using namespace std;
+
+namespace RTMP
+{
+    class Transport;
+
+    /**
+     * Sidecar keyframe index, <file>.idx.
+     *
+     * Built by one scan of the FLV file, then mapped as is: a header
+     * followed by the keyframes in timestamp order. It is a cache in host
+     * byte order, rebuilt when the FLV file's size or modification time
+     * no longer match.
+     **/
+    struct VodIndexHeader
+    {
+        char magic[8];
+        uint64_t fileSize;
+        int64_t modified;
+
+        // Positions of the first metadata and sequence header tags, 0 if none.
+        uint64_t metadata;
+        uint64_t videoHeader;
+        uint64_t audioHeader;
+
+        uint64_t count;
+    };
+
+    struct VodIndexEntry
+    {
+        uint32_t timestamp;
+        uint32_t reserved;
+        uint64_t position;
+    };
+
+    /**
+     * FLV tag read from a mapping.
+     **/
+    struct VodTag
+    {
+        int type = 0;
+        unsigned int timestamp = 0;
+        const unsigned char* data = nullptr;
+        size_t length = 0;
+
+        // Position of the tag that follows.
+        uint64_t next = 0;
+    };
+
+    /**
+     * FLV file mapped in memory, with its keyframe index.
+     *
+     * Shared by every session playing it: payloads are queued by reference
+     * into the mapping, so the file is read once through the page cache
+     * however many play it. Read-only once opened, from any thread.
+     **/
+    class VodFile
+    {
+        private:
+            const unsigned char* data = nullptr;
+            size_t size = 0;
+
+            const unsigned char* index = nullptr;
+            size_t indexSize = 0;
+
+            const VodIndexHeader* header = nullptr;
+            const VodIndexEntry* entries = nullptr;
+
+            // Index built when it could not be saved next to the file.
+            vector<unsigned char> builtIndex;
+
+            uint64_t firstTag = 0;
+
+            // Identity of the file mapped; modification time in nanoseconds.
+            uint64_t device = 0;
+            uint64_t inode = 0;
+            int64_t modified = 0;
+
+            bool UseIndex(const unsigned char* bytes, size_t length, int64_t modified);
+            bool MapIndex(const string& path, int64_t modified);
+            vector<unsigned char> BuildIndex(int64_t modified) const;
+
+        public:
+            VodFile() {};
+            ~VodFile();
+
+            VodFile(const VodFile&) = delete;
+            VodFile& operator=(const VodFile&) = delete;
+
+            /**
+             * Map the FLV file at `path`, and its index unless missing or
+             * stale. Returns nullptr if the file is not FLV.
+             **/
+            static shared_ptr<VodFile> Map(const string& path);
+
+            /**
+             * Build the index of a file mapped without one, and save it
+             * next to the file. Scans the whole file.
+             **/
+            bool Index(const string& path);
+
+            bool Indexed() const { return header != nullptr; }
+
+            /**
+             * Whether `path` still names the file mapped, unchanged: same
+             * inode, size and modification time.
+             **/
+            bool Matches(const string& path) const;
+
+            size_t Size() const { return size; }
+
+            /**
+             * Tag at `position`. Returns false past the last complete tag.
+             **/
+            bool ReadTag(uint64_t position, VodTag& tag) const;
+
+            /**
+             * Position of the last keyframe at or before `milliseconds`,
+             * by binary search in the index. The first tag if there is none.
+             **/
+            uint64_t Seek(unsigned int milliseconds) const;
+
+            uint64_t FirstTag() const { return firstTag; }
+            uint64_t Metadata() const { return header->metadata; }
+            uint64_t VideoHeader() const { return header->videoHeader; }
+            uint64_t AudioHeader() const { return header->audioHeader; }
+            size_t KeyframeCount() const { return (size_t)header->count; }
+    };
+
+    /**
+     * Files being played, by path.
+     *
+     * Sessions playing the same file share one mapping; it is unmapped when
+     * the last of them stops. A file replaced or grown since it was mapped
+     * is mapped again for the next sessions, the others keep the old one.
+     **/
+    class VodLibrary
+    {
+        private:
+            string directory = ".";
+
+            mutex lock;
+            unordered_map<string, weak_ptr<VodFile>> files;
+
+            /**
+             * The file played from `path`: `file`, or the one opened
+             * meanwhile by another session, unless it is `cached`.
+             **/
+            shared_ptr<VodFile> Share(const string& path, const shared_ptr<VodFile>& file, const shared_ptr<VodFile>& cached);
+
+        public:
+            /**
+             * Directory files are played from. Set before playing.
+             **/
+            void SetDirectory(const string& path) { directory = path; }
+
+            /**
+             * Call `ready` with the file of stream `name` (see
+             * Recorder::FileName), or nullptr. Right away when the file is
+             * indexed; otherwise it is indexed on the recorder's I/O thread,
+             * and `ready` is posted to `transport`. May be called from any
+             * transport's thread.
+             **/
+            void Open(const string& name, Transport& transport, function<void(shared_ptr<VodFile>)> ready);
+
+            /**
+             * Library used by the handler.
+             **/
+            static VodLibrary& Default();
+    };
+
+    /**
+     * Session's position in the file it plays.
+     *
+     * Tags are queued a window at a time: the next window is queued once
+     * the transport has written the previous one, so the socket paces
+     * the playback.
+     **/
+    struct VodPlayback
+    {
+        static constexpr size_t Window = 256 * 1024;
+
+        shared_ptr<VodFile> file;
+        uint64_t position = 0;
+
+        // Whether the end of the file was reached and signalled.
+        bool ended = false;
+
+        /**
+         * Name of the stream whose file is being indexed for a play. The
+         * play goes on once it is, unless this was reset meanwhile.
+         **/
+        shared_ptr<const string> opening;
+    };
+}
@@ -0,0 +1,153 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * AMF0 encoding and decoding, of well-formed and malformed data.
+ **/
+
+#include "Test.hpp"
+#include "TestValues.hpp"
+
+#include <vector>
+
+using namespace RTMP;
+using namespace Test;
+
+static bool Decode(const vector<char>& data, AMF0Arena& arena, const AMF0Value*& values, size_t& count)
+{
+    return AMF0Decoder::Decode(reinterpret_cast<const unsigned char*>(data.data()), data.size(), arena, values, count);
+}
+
+/**
+ * Connect command object, with a nested object and a strict array.
+ **/
+static vector<char> EncodeSample(AMF0Value& sample)
+{
+    static const AMF0Property nested[] = {
+        { "app", String("live") },
+        { "depth", Number(1) }
+    };
+    static const AMF0Value tags[] = { String("a"), String("live"), Null(), Number(-0.5) };
+    static const AMF0Property properties[] = {
+        { "app", String("live") },
+        { "flashVer", String("FMLE/3.0 (compatible; FMSc/1.0)") },
+        { "audio", Boolean(true) },
+        { "video", Boolean(false) },
+        { "fps", Number(29.97) },
+        { "nested", Object(nested, 2) },
+        { "tags", StrictArray(tags, 4) },
+        { "none", Null() },
+        { "", String("empty key") }
+    };
+    sample = Object(properties, sizeof(properties) / sizeof(properties[0]));
+
+    vector<char> data;
+    AMF0Encoder::Write(data, String("connect"));
+    AMF0Encoder::Write(data, Number(1));
+    AMF0Encoder::Write(data, sample);
+    return data;
+}
+
+static void RoundTrip()
+{
+    AMF0Value sample;
+    vector<char> data = EncodeSample(sample);
+
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+    CHECK(Decode(data, arena, values, count));
+    CHECK(count == 3);
+    if (count != 3)
+        return;
+
+    CHECK(Same(values[0], String("connect")));
+    CHECK(Same(values[1], Number(1)));
+    CHECK(Same(values[2], sample));
+
+    const AMF0Value* app = values[2].Find("app");
+    CHECK(app != nullptr && app->string == "live");
+    CHECK(values[2].Find("missing") == nullptr);
+}
+
+static void LongString()
+{
+    // Past 65535 bytes, written as a long string.
+    string text(70000, 'x');
+    vector<char> data;
+    AMF0Encoder::Write(data, String(text));
+    CHECK((unsigned char)data[0] == 0x0C);
+
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+    CHECK(Decode(data, arena, values, count));
+    CHECK(count == 1 && Same(values[0], String(text)));
+}
+
+static void TruncatedIsRejected()
+{
+    AMF0Value sample;
+    vector<char> data;
+    EncodeSample(sample);
+    AMF0Encoder::Write(data, sample);
+
+    // Every prefix of a single value ends inside it.
+    AMF0Arena arena;
+    for (size_t length = 1; length < data.size(); length++)
+    {
+        const AMF0Value* values = nullptr;
+        size_t count = 0;
+        vector<char> prefix(data.begin(), data.begin() + length);
+        CHECK(!Decode(prefix, arena, values, count));
+        arena.Reset();
+    }
+}
+
+static void MalformedIsRejected()
+{
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+
+    // Unknown marker.
+    CHECK(!Decode(vector<char> { 0x42 }, arena, values, count));
+
+    // String longer than the data.
+    CHECK(!Decode(vector<char> { 0x02, 0x00, 0x10, 'a', 'b' }, arena, values, count));
+
+    // Strict array announcing more elements than there are bytes.
+    CHECK(!Decode(vector<char> { 0x0A, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, 0x05 }, arena, values, count));
+
+    // Object key without a value.
+    CHECK(!Decode(vector<char> { 0x03, 0x00, 0x01, 'k' }, arena, values, count));
+}
+
+static void NestingIsBounded()
+{
+    // Strict arrays of one element, each holding the next, down to a null.
+    vector<char> data;
+    for (int i = 0; i < AMF0Decoder::MaximumDepth; i++)
+        data.insert(data.end(), { 0x0A, 0x00, 0x00, 0x00, 0x01 });
+    data.push_back(0x05);
+
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+    CHECK(!Decode(data, arena, values, count));
+
+    // Within the limit.
+    vector<char> shallow(data.begin() + 5, data.end());
+    CHECK(Decode(shallow, arena, values, count));
+}
+
+int main()
+{
+    int status = 0;
+    status |= RUN_TEST(RoundTrip);
+    status |= RUN_TEST(LongString);
+    status |= RUN_TEST(TruncatedIsRejected);
+    status |= RUN_TEST(MalformedIsRejected);
+    status |= RUN_TEST(NestingIsBounded);
+    return status;
+}
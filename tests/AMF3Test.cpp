@@ -0,0 +1,153 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * AMF3 encoding and decoding, of well-formed and malformed data.
+ **/
+
+#include "Test.hpp"
+#include "TestValues.hpp"
+
+#include "../RTMPAMF3.hpp"
+
+#include <vector>
+
+using namespace RTMP;
+using namespace Test;
+
+// AMF3 value behind the AMF0 avmplus-object marker.
+static vector<char> Encode(const AMF0Value& value)
+{
+    vector<char> data { 0x11 };
+    AMF3Encoder encoder(data);
+    encoder.Write(value);
+    return data;
+}
+
+static bool Decode(const vector<char>& data, AMF0Arena& arena, const AMF0Value*& values, size_t& count)
+{
+    return AMF0Decoder::Decode(reinterpret_cast<const unsigned char*>(data.data()), data.size(), arena, values, count);
+}
+
+/**
+ * Objects of the same shape, the same object twice, repeated strings,
+ * integers and doubles.
+ **/
+static AMF0Value Sample()
+{
+    static const AMF0Property first[] = {
+        { "name", String("live") },
+        { "width", Number(1280) }
+    };
+    static const AMF0Property second[] = {
+        { "name", String("backup") },
+        { "width", Number(-640) }
+    };
+    static const AMF0Value elements[] = {
+        Object(first, 2),
+        Object(second, 2),
+        Object(first, 2),
+        String("live"),
+        Number(29.97),
+        Number(1099511627776.0),
+        Boolean(true),
+        Null()
+    };
+    static const AMF0Property properties[] = {
+        { "app", String("live") },
+        { "streams", StrictArray(elements, sizeof(elements) / sizeof(elements[0])) },
+        { "audio", Boolean(false) }
+    };
+    return Object(properties, sizeof(properties) / sizeof(properties[0]));
+}
+
+static void RoundTrip()
+{
+    AMF0Value sample = Sample();
+    vector<char> data = Encode(sample);
+
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+    CHECK(Decode(data, arena, values, count));
+    CHECK(count == 1);
+    if (count == 1)
+        CHECK(Same(values[0], sample));
+}
+
+static void StringsAreReferenced()
+{
+    static const AMF0Value elements[] = { String("live"), String("live") };
+    vector<char> data = Encode(StrictArray(elements, 2));
+
+    // Array of two dense elements, the string inline, then by reference to index 0.
+    vector<char> expected { 0x11, 0x09, 0x05, 0x01, 0x06, 0x09, 'l', 'i', 'v', 'e', 0x06, 0x00 };
+    CHECK(data == expected);
+}
+
+static void TruncatedIsRejected()
+{
+    vector<char> data = Encode(Sample());
+
+    AMF0Arena arena;
+    for (size_t length = 1; length < data.size(); length++)
+    {
+        const AMF0Value* values = nullptr;
+        size_t count = 0;
+        vector<char> prefix(data.begin(), data.begin() + length);
+        CHECK(!Decode(prefix, arena, values, count));
+        arena.Reset();
+    }
+}
+
+static void MalformedIsRejected()
+{
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+
+    // Reference to a string never sent.
+    CHECK(!Decode(vector<char> { 0x11, 0x06, 0x00 }, arena, values, count));
+
+    // Inline string longer than the data.
+    CHECK(!Decode(vector<char> { 0x11, 0x06, 0x7F, 'a' }, arena, values, count));
+
+    // Object with a reference to traits never sent.
+    CHECK(!Decode(vector<char> { 0x11, 0x0A, 0x01 }, arena, values, count));
+
+    // Integer cut in the middle of its variable length.
+    CHECK(!Decode(vector<char> { 0x11, 0x04, (char)0x80 }, arena, values, count));
+
+    // Dense array announcing more elements than there are bytes.
+    CHECK(!Decode(vector<char> { 0x11, 0x09, (char)0xFF, (char)0xFF, (char)0xFF, 0x7F, 0x01 }, arena, values, count));
+}
+
+static void NestingIsBounded()
+{
+    // Arrays of one dense element, each holding the next, down to a null.
+    vector<char> data { 0x11 };
+    for (int i = 0; i < AMF0Decoder::MaximumDepth; i++)
+        data.insert(data.end(), { 0x09, 0x03, 0x01 });
+    data.push_back(0x01);
+
+    AMF0Arena arena;
+    const AMF0Value* values = nullptr;
+    size_t count = 0;
+    CHECK(!Decode(data, arena, values, count));
+
+    // Within the limit.
+    vector<char> shallow { 0x11 };
+    shallow.insert(shallow.end(), data.begin() + 4, data.end());
+    CHECK(Decode(shallow, arena, values, count));
+}
+
+int main()
+{
+    int status = 0;
+    status |= RUN_TEST(RoundTrip);
+    status |= RUN_TEST(StringsAreReferenced);
+    status |= RUN_TEST(TruncatedIsRejected);
+    status |= RUN_TEST(MalformedIsRejected);
+    status |= RUN_TEST(NestingIsBounded);
+    return status;
+}
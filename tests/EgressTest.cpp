@@ -0,0 +1,82 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Egress budget of a slow subscriber.
+ **/
+
+#include "Test.hpp"
+#include "TestTransport.hpp"
+
+#include "../RTMPHandler.hpp"
+#include "../RTMPSession.hpp"
+#include "../RTMPMessage.hpp"
+
+#include <vector>
+
+using namespace RTMP;
+
+static shared_ptr<const MediaMessage> Video(bool keyframe, unsigned int timestamp)
+{
+    unsigned char payload[] = { (unsigned char)(keyframe ? 0x17 : 0x27), 0x01, 0, 0, 0, 0, 0, 0, 1, 0x65 };
+    return make_shared<MediaMessage>(BufferPool::Default(), Message::Type::VideoMessage, timestamp, payload, sizeof(payload));
+}
+
+// AAC raw frame: sound format 10, packet type 1.
+static shared_ptr<const MediaMessage> Audio(unsigned int timestamp)
+{
+    unsigned char payload[] = { 0xAF, 0x01, 0x21, 0x10 };
+    return make_shared<MediaMessage>(BufferPool::Default(), Message::Type::AudioMessage, timestamp, payload, sizeof(payload));
+}
+
+// Leave `bytes` unwritten in the session's outbound queue.
+static void Backlog(Session& session, size_t bytes)
+{
+    vector<char> filler(bytes);
+    session.outbound.Append(filler.data(), filler.size());
+}
+
+static void AudioKeptWhileVideoShed()
+{
+    TestTransport transport;
+    Session session;
+    session.transport = &transport;
+    session.egress.maximumBytes = 256;
+
+    Backlog(session, 300);
+
+    CHECK(Handler::SendMedia(session, Video(false, 0)) == 0);
+    CHECK(session.metrics.droppedVideo == 1);
+
+    CHECK(Handler::SendMedia(session, Audio(0)) > 0);
+    CHECK(session.metrics.queuedMessages == 1);
+    CHECK(!session.closing);
+}
+
+static void StalledSubscriberIsClosed()
+{
+    TestTransport transport;
+    Session session;
+    session.transport = &transport;
+    session.egress.maximumBytes = 256;
+
+    Backlog(session, 512);
+
+    CHECK(Handler::SendMedia(session, Audio(0)) < 0);
+    CHECK(session.closing);
+    CHECK(session.sendScheduled);
+    CHECK(session.metrics.droppedOverflow == 1);
+    CHECK(session.metrics.queuedMessages == 0);
+
+    // Nothing more is queued to a session on its way out.
+    CHECK(Handler::SendMedia(session, Video(true, 40)) < 0);
+    CHECK(session.metrics.droppedOverflow == 1);
+}
+
+int main()
+{
+    int status = 0;
+    status |= RUN_TEST(AudioKeptWhileVideoShed);
+    status |= RUN_TEST(StalledSubscriberIsClosed);
+    return status;
+}
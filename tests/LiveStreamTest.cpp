@@ -0,0 +1,256 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Live stream fan-out and subscription ordering.
+ **/
+
+#include "Test.hpp"
+#include "TestTransport.hpp"
+
+#include "../RTMPLiveStream.hpp"
+#include "../RTMPSession.hpp"
+#include "../RTMPMessage.hpp"
+#include "../RTMPEndian.hpp"
+
+#include <vector>
+
+using namespace RTMP;
+
+// Video tag: frame type in the high nibble (1 keyframe, 2 inter frame), AVC codec, NAL unit.
+static shared_ptr<const MediaMessage> Video(bool keyframe, unsigned int timestamp)
+{
+    unsigned char payload[] = { (unsigned char)(keyframe ? 0x17 : 0x27), 0x01, 0, 0, 0, 0, 0, 0, 1, 0x65 };
+    return make_shared<MediaMessage>(BufferPool::Default(), Message::Type::VideoMessage, timestamp, payload, sizeof(payload));
+}
+
+// AVC sequence header: keyframe, AVC codec, packet type 0.
+static shared_ptr<const MediaMessage> VideoHeader(unsigned int timestamp)
+{
+    unsigned char payload[] = { 0x17, 0x00, 0, 0, 0, 0x01, 0x64, 0, 0x1F };
+    return make_shared<MediaMessage>(BufferPool::Default(), Message::Type::VideoMessage, timestamp, payload, sizeof(payload));
+}
+
+static void Subscribe(const shared_ptr<LiveStream>& stream, Session& session)
+{
+    session.playing = stream;
+    stream->Subscribe(session);
+}
+
+/**
+ * Timestamps of the messages queued to `session`, in order, read back
+ * from their chunk headers. Messages are expected to fit in one chunk.
+ **/
+static vector<unsigned int> Timestamps(const Session& session)
+{
+    vector<unsigned char> bytes;
+    Slice slices[64];
+    size_t count = session.outbound.Gather(slices, 64);
+    for (size_t i = 0; i < count; i++)
+        bytes.insert(bytes.end(), slices[i].data, slices[i].data + slices[i].length);
+
+    // Per chunk stream: timestamp, delta and length of the last message.
+    unsigned int timestamps[64] = {}, deltas[64] = {}, lengths[64] = {};
+    vector<unsigned int> found;
+    size_t position = 0;
+    while (position < bytes.size())
+    {
+        unsigned int format = bytes[position] >> 6;
+        unsigned int csid = bytes[position] & 0x3F;
+        const unsigned char* header = bytes.data() + position + 1;
+
+        if (format == 0)
+        {
+            timestamps[csid] = Endian::Load24BE(header);
+            deltas[csid] = 0;
+        }
+        else if (format < 3)
+        {
+            deltas[csid] = Endian::Load24BE(header);
+            timestamps[csid] += deltas[csid];
+        }
+        else
+        {
+            timestamps[csid] += deltas[csid];
+        }
+        if (format < 2)
+            lengths[csid] = Endian::Load24BE(header + 3);
+
+        static const size_t HeaderLengths[] = { 11, 7, 3, 0 };
+        position += 1 + HeaderLengths[format] + lengths[csid];
+        found.push_back(timestamps[csid]);
+    }
+    return found;
+}
+
+static void PublishReachesEveryGroup()
+{
+    TestTransport origin, remote;
+    Session local, far;
+    local.transport = &origin;
+    far.transport = &remote;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    Subscribe(stream, local);
+    Subscribe(stream, far);
+
+    stream->Publish(Video(true, 0), &origin);
+    stream->Publish(Video(false, 40), &origin);
+
+    // In place for the publisher's thread, posted to the others.
+    CHECK(local.metrics.queuedMessages == 2);
+    CHECK(far.metrics.queuedMessages == 0);
+
+    remote.Turn();
+    CHECK(far.metrics.queuedMessages == 2);
+}
+
+static void PrimerStartsAtTheKeyframe()
+{
+    TestTransport origin;
+    Session late;
+    late.transport = &origin;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    stream->Publish(Video(false, 0), &origin);
+    stream->Publish(Video(true, 40), &origin);
+    stream->Publish(Video(false, 80), &origin);
+
+    // Nothing before the first keyframe is worth sending.
+    Subscribe(stream, late);
+    CHECK(late.metrics.queuedMessages == 2);
+}
+
+static void SubscribeBeforePostedDeliveryRuns()
+{
+    TestTransport origin, remote;
+    Session first, second;
+    first.transport = &remote;
+    second.transport = &remote;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    Subscribe(stream, first);
+
+    // Cached and posted to the remote group, which has not run it yet.
+    stream->Publish(Video(true, 0), &origin);
+
+    // Joins in between: the keyframe comes with its primer.
+    Subscribe(stream, second);
+    CHECK(second.metrics.queuedMessages == 1);
+
+    // The posted delivery must not send it a second time.
+    remote.Turn();
+    CHECK(first.metrics.queuedMessages == 1);
+    CHECK(second.metrics.queuedMessages == 1);
+
+    stream->Publish(Video(false, 40), &origin);
+    remote.Turn();
+    CHECK(first.metrics.queuedMessages == 2);
+    CHECK(second.metrics.queuedMessages == 2);
+}
+
+static void PrimerHoldsTheSequenceHeader()
+{
+    TestTransport origin;
+    Session late;
+    late.transport = &origin;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    stream->Publish(VideoHeader(0), &origin);
+    stream->Publish(Video(true, 40), &origin);
+    stream->Publish(Video(false, 80), &origin);
+    stream->Publish(Video(true, 120), &origin);
+    stream->Publish(Video(false, 160), &origin);
+
+    // The decoder configuration, then the last group of pictures.
+    Subscribe(stream, late);
+    CHECK(Timestamps(late) == vector<unsigned int>({ 0, 120, 160 }));
+
+    stream->Publish(Video(false, 200), &origin);
+    CHECK(Timestamps(late) == vector<unsigned int>({ 0, 120, 160, 200 }));
+}
+
+static void RemoteGroupsKeepPublishOrder()
+{
+    TestTransport origin, remote;
+    Session first, second;
+    first.transport = &remote;
+    second.transport = &remote;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    Subscribe(stream, first);
+
+    stream->Publish(Video(true, 0), &origin);
+    stream->Publish(Video(false, 40), &origin);
+
+    // Joins with the two messages posted and not yet delivered.
+    Subscribe(stream, second);
+    stream->Publish(Video(false, 80), &origin);
+
+    remote.Turn();
+    CHECK(Timestamps(first) == vector<unsigned int>({ 0, 40, 80 }));
+    CHECK(Timestamps(second) == vector<unsigned int>({ 0, 40, 80 }));
+}
+
+static void UnsubscribeStopsDelivery()
+{
+    TestTransport origin, remote;
+    Session local, far;
+    local.transport = &origin;
+    far.transport = &remote;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    Subscribe(stream, local);
+    Subscribe(stream, far);
+
+    stream->Publish(Video(true, 0), &origin);
+    stream->Unsubscribe(local);
+    stream->Unsubscribe(far);
+    stream->Publish(Video(false, 40), &origin);
+
+    // Already posted when it left: not delivered either.
+    remote.Turn();
+    CHECK(local.metrics.queuedMessages == 1);
+    CHECK(far.metrics.queuedMessages == 0);
+}
+
+static void EndDetachesEverySubscriber()
+{
+    TestTransport origin, remote;
+    Session local, far;
+    local.transport = &origin;
+    far.transport = &remote;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    Subscribe(stream, local);
+    Subscribe(stream, far);
+
+    stream->End(&origin);
+    CHECK(local.playing == nullptr);
+    CHECK(!local.outbound.Empty());
+    CHECK(far.playing != nullptr);
+
+    remote.Turn();
+    CHECK(far.playing == nullptr);
+    CHECK(!far.outbound.Empty());
+
+    // Too late to join: told right away instead.
+    Session late;
+    late.transport = &remote;
+    Subscribe(stream, late);
+    CHECK(late.playing == nullptr);
+    CHECK(!late.outbound.Empty());
+}
+
+int main()
+{
+    int status = 0;
+    status |= RUN_TEST(PublishReachesEveryGroup);
+    status |= RUN_TEST(PrimerStartsAtTheKeyframe);
+    status |= RUN_TEST(SubscribeBeforePostedDeliveryRuns);
+    status |= RUN_TEST(PrimerHoldsTheSequenceHeader);
+    status |= RUN_TEST(RemoteGroupsKeepPublishOrder);
+    status |= RUN_TEST(UnsubscribeStopsDelivery);
+    status |= RUN_TEST(EndDetachesEverySubscriber);
+    return status;
+}
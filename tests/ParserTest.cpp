@@ -0,0 +1,153 @@
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Chunk parsing: reassembly, partial input and malformed headers.
+ **/
+
+#include "Test.hpp"
+#include "TestTransport.hpp"
+
+#include "../RTMPParser.hpp"
+#include "../RTMPLiveStream.hpp"
+
+#include <algorithm>
+#include <vector>
+
+using namespace RTMP;
+
+/**
+ * Type 0 chunk header: basic header, timestamp, message length, type,
+ * then the message stream ID, little-endian.
+ **/
+static void Type0(vector<unsigned char>& data, unsigned char csid, unsigned int length, unsigned char type)
+{
+    data.insert(data.end(), {
+        csid, 0, 0, 0,
+        (unsigned char)(length >> 16), (unsigned char)(length >> 8), (unsigned char)length,
+        type, 1, 0, 0, 0
+    });
+}
+
+static void Receive(Session& session, const vector<unsigned char>& data)
+{
+    session.receiveBuffer.Write(data.data(), data.size());
+}
+
+static void SetChunkSize()
+{
+    Session session;
+    vector<unsigned char> data;
+    Type0(data, 2, 4, 1);
+    data.insert(data.end(), { 0x00, 0x00, 0x10, 0x00 });
+
+    Receive(session, data);
+    CHECK(Parser::ParseChunks(session) >= 0);
+    CHECK(session.inChunkSize == 4096);
+    CHECK(session.receiveBuffer.Empty());
+}
+
+static void MessageAcrossChunks()
+{
+    TestTransport transport;
+    Session publisher, player;
+    publisher.transport = &transport;
+    player.transport = &transport;
+
+    shared_ptr<LiveStream> stream = make_shared<LiveStream>("live");
+    publisher.publishing = stream;
+    player.playing = stream;
+    stream->Subscribe(player);
+
+    // Keyframe of 300 bytes: chunks of 128, 128 and 44 bytes.
+    vector<unsigned char> payload(300);
+    for (size_t i = 0; i < payload.size(); i++)
+        payload[i] = (unsigned char)i;
+    payload[0] = 0x17;
+
+    vector<unsigned char> data;
+    Type0(data, 6, 300, 9);
+    data.insert(data.end(), payload.begin(), payload.begin() + 128);
+    data.push_back(0xC6);
+    data.insert(data.end(), payload.begin() + 128, payload.begin() + 256);
+    data.push_back(0xC6);
+    data.insert(data.end(), payload.begin() + 256, payload.end());
+
+    // One byte at a time: every chunk is held back until complete.
+    for (unsigned char byte : data)
+    {
+        CHECK(player.metrics.queuedMessages == 0);
+        Receive(publisher, vector<unsigned char> { byte });
+        CHECK(Parser::ParseChunks(publisher) >= 0);
+    }
+    CHECK(player.metrics.queuedMessages == 1);
+    CHECK(publisher.partialBytes == 0);
+    CHECK(publisher.receiveBuffer.Empty());
+
+    // Sent on as a Type 0 chunk then Type 3 ones, the payload unchanged.
+    vector<unsigned char> sent;
+    Slice slices[16];
+    size_t count = player.outbound.Gather(slices, 16);
+    for (size_t i = 0; i < count; i++)
+        sent.insert(sent.end(), slices[i].data, slices[i].data + slices[i].length);
+    CHECK(sent.size() == 12 + 300 + 2);
+    if (sent.size() == 12 + 300 + 2)
+    {
+        CHECK(equal(payload.begin(), payload.begin() + 128, sent.begin() + 12));
+        CHECK(equal(payload.begin() + 128, payload.begin() + 256, sent.begin() + 12 + 128 + 1));
+        CHECK(equal(payload.begin() + 256, payload.end(), sent.begin() + 12 + 256 + 2));
+    }
+}
+
+static void CompressedHeaderOnUnknownStream()
+{
+    // Type 1 header: nothing to inherit the message stream ID from.
+    Session session;
+    Receive(session, vector<unsigned char> { 0x43, 0, 0, 0, 0, 0, 4, 1, 0, 0, 0, 0 });
+    CHECK(Parser::ParseChunks(session) < 0);
+    CHECK(session.closing);
+}
+
+static void PartialBytesAreBounded()
+{
+    // The first chunk of the largest message reserves all of it.
+    Session session;
+    for (unsigned char csid = 3; csid < 5; csid++)
+    {
+        vector<unsigned char> data;
+        Type0(data, csid, 0xFFFFFF, 9);
+        data.insert(data.end(), 128, 0x27);
+        Receive(session, data);
+        CHECK(Parser::ParseChunks(session) >= 0);
+    }
+    CHECK(session.partialBytes == Session::MaximumPartialBytes);
+
+    // Abort gives back what a chunk stream reserved.
+    vector<unsigned char> abort;
+    Type0(abort, 2, 4, 2);
+    abort.insert(abort.end(), { 0x00, 0x00, 0x00, 0x04 });
+    Receive(session, abort);
+    CHECK(Parser::ParseChunks(session) >= 0);
+    CHECK(session.partialBytes == Session::MaximumPartialBytes / 2);
+
+    // A message too many closes the session.
+    for (unsigned char csid = 5; csid < 7; csid++)
+    {
+        vector<unsigned char> data;
+        Type0(data, csid, 0xFFFFFF, 9);
+        data.insert(data.end(), 128, 0x27);
+        Receive(session, data);
+    }
+    CHECK(Parser::ParseChunks(session) < 0);
+    CHECK(session.closing);
+}
+
+int main()
+{
+    int status = 0;
+    status |= RUN_TEST(SetChunkSize);
+    status |= RUN_TEST(MessageAcrossChunks);
+    status |= RUN_TEST(CompressedHeaderOnUnknownStream);
+    status |= RUN_TEST(PartialBytesAreBounded);
+    return status;
+}
@@ -0,0 +1,36 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Minimal test harness: every test is a function run by the file's main,
+ * CHECK counts the failures and main returns non-zero if there were any.
+ **/
+
+#include <cstdio>
+
+namespace Test
+{
+    inline int failures = 0;
+
+    inline int Run(void (*test)(), const char* name)
+    {
+        int before = failures;
+        test();
+        printf("%s %s\n", failures == before ? "PASS" : "FAIL", name);
+        return failures == before ? 0 : 1;
+    }
+}
+
+#define CHECK(condition) \
+    do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: CHECK(%s) failed.\n", __FILE__, __LINE__, #condition); \
+            Test::failures++; \
+        } \
+    } \
+    while (0)
+
+#define RUN_TEST(test) Test::Run(test, #test)
@@ -0,0 +1,32 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * Transport without sockets: posted tasks and timers run when the test says so.
+ **/
+
+#include "../RTMPTransport.hpp"
+
+namespace RTMP
+{
+    class TestTransport : public Transport
+    {
+        protected:
+            void Wake() override {}
+
+        public:
+            int Listen(unsigned short, int) override { return -1; }
+            int Run() override { return 0; }
+            void Stop() override {}
+
+            /**
+             * One loop turn: posted tasks, then expired timers.
+             **/
+            void Turn()
+            {
+                RunPosted();
+                RunTimers();
+            }
+    };
+}
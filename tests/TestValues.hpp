@@ -0,0 +1,113 @@
+#pragma once
+/**
+ * Author: Simon Brisebois-Therrien
+ * Date: 2026-10-16
+ *
+ * AMF values built by hand, and compared by content.
+ **/
+
+#include "../RTMPAMF0.hpp"
+
+#include <cmath>
+
+namespace Test
+{
+    using RTMP::AMF0Value;
+    using RTMP::AMF0Property;
+
+    inline AMF0Value Number(double number)
+    {
+        AMF0Value value;
+        value.type = AMF0Value::Type::Number;
+        value.number = number;
+        return value;
+    }
+
+    inline AMF0Value Boolean(bool boolean)
+    {
+        AMF0Value value;
+        value.type = AMF0Value::Type::Boolean;
+        value.boolean = boolean;
+        return value;
+    }
+
+    inline AMF0Value String(std::string_view text)
+    {
+        AMF0Value value;
+        value.type = AMF0Value::Type::String;
+        value.string = text;
+        return value;
+    }
+
+    inline AMF0Value Null()
+    {
+        AMF0Value value;
+        value.type = AMF0Value::Type::Null;
+        return value;
+    }
+
+    inline AMF0Value Object(const AMF0Property* properties, size_t count)
+    {
+        AMF0Value value;
+        value.type = AMF0Value::Type::Object;
+        value.properties = properties;
+        value.count = count;
+        return value;
+    }
+
+    inline AMF0Value StrictArray(const AMF0Value* elements, size_t count)
+    {
+        AMF0Value value;
+        value.type = AMF0Value::Type::StrictArray;
+        value.elements = elements;
+        value.count = count;
+        return value;
+    }
+
+    /**
+     * Whether `a` and `b` hold the same content, in the same order.
+     **/
+    inline bool Same(const AMF0Value& a, const AMF0Value& b)
+    {
+        if (a.type != b.type || a.count != b.count)
+            return false;
+
+        switch (a.type)
+        {
+            case AMF0Value::Type::Number:
+            case AMF0Value::Type::Date:
+                return a.number == b.number || (std::isnan(a.number) && std::isnan(b.number));
+
+            case AMF0Value::Type::Boolean:
+                return a.boolean == b.boolean;
+
+            case AMF0Value::Type::String:
+            case AMF0Value::Type::XmlDocument:
+            case AMF0Value::Type::ByteArray:
+                return a.string == b.string;
+
+            case AMF0Value::Type::Object:
+            case AMF0Value::Type::EcmaArray:
+            case AMF0Value::Type::TypedObject:
+                if (a.type == AMF0Value::Type::TypedObject && a.string != b.string)
+                    return false;
+                for (size_t i = 0; i < a.count; i++)
+                {
+                    if (a.properties[i].key != b.properties[i].key || !Same(a.properties[i].value, b.properties[i].value))
+                        return false;
+                }
+                return true;
+
+            case AMF0Value::Type::StrictArray:
+                for (size_t i = 0; i < a.count; i++)
+                {
+                    if (!Same(a.elements[i], b.elements[i]))
+                        return false;
+                }
+                return true;
+
+            default:
+                return true;
+        }
+    }
+}